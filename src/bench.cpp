@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dataset.h"
+#include "model.h"
+#include "engine/graph.h"
+#include "engine/interpreter.h"
+#include "engine/parallel.h"
+#include "engine/sparse.h"
+#include "engine/timing.h"
+#include "engine/tuning.h"
+#include "engine/winograd.h"
+#include "utils/resample.h"
+
+static const size_t BENCH_INPUTS = 16;
+static const size_t BENCH_ROUNDS = 5;
+static const size_t BENCH_REPEATS = 20;
+static const size_t BENCH_ITERATIONS = 20;
+static const size_t BENCH_LATENCY_CALLS = 500;
+static const size_t BENCH_MAX_THREADS = 4;
+static const unsigned int BENCH_MODEL_RATE = 16000;
+
+// Keeps the least disturbed of several measurements of the same code
+static void keep_best(TimingStats &best, const TimingStats &stats) {
+    if (best.repeats == 0 || stats.min_ns < best.min_ns)
+        best = stats;
+}
+
+static void print_stats(const char *name, const TimingStats &stats) {
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << stats.mean_ns / 1000 << " us/inference (stddev " << stats.stddev_ns / 1000
+              << " us, min " << stats.min_ns / 1000 << " us)" << std::endl;
+}
+
+static void print_latency(const char *name, const LatencyStats &stats, const LatencyStats &baseline) {
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1)
+              << "p50 " << std::setw(8) << stats.p50_ns / 1000 << " us (x" << std::setprecision(2)
+              << baseline.p50_ns / stats.p50_ns << "), p99 " << std::setprecision(1) << std::setw(8)
+              << stats.p99_ns / 1000 << " us (x" << std::setprecision(2) << baseline.p99_ns / stats.p99_ns
+              << "), max " << std::setprecision(1) << stats.max_ns / 1000 << " us" << std::endl;
+}
+
+// Single-input latency of the tuned interpreter on one thread and with its layers split across a worker pool
+static void bench_parallel_latency(Interpreter &interpreter, const std::vector<number_t> &inputs) {
+    const size_t input_size = interpreter.graph().input_size(), count = inputs.size() / input_size;
+    const size_t threads = std::min<size_t>(std::thread::hardware_concurrency(), BENCH_MAX_THREADS);
+    std::vector<number_t> expected(count * interpreter.graph().output_size()), outputs(interpreter.graph().output_size());
+    for (size_t i = 0; i < count; i++)
+        interpreter.run(&inputs[i * input_size], &expected[i * outputs.size()]);
+
+    size_t next = 0;
+    auto run = [&] { interpreter.run(&inputs[next++ % count * input_size], outputs.data()); };
+    const LatencyStats single = measure_latency(run, BENCH_LATENCY_CALLS);
+    print_latency("1 thread", single, single);
+    if (threads < 2) {
+        std::cout << "Only one hardware thread, intra-inference parallelism skipped" << std::endl;
+        return;
+    }
+
+    for (size_t t = 2; t <= threads; t++) {
+        WorkerPool pool(t);
+        interpreter.set_pool(&pool);
+        for (size_t i = 0; i < count; i++) {
+            interpreter.run(&inputs[i * input_size], outputs.data());
+            if (!std::equal(outputs.begin(), outputs.end(), &expected[i * outputs.size()])) {
+                std::cerr << "Parallel output differs from single-threaded on input " << i << std::endl;
+                exit(1);
+            }
+        }
+
+        std::cout << std::to_string(t) + " threads, split:";
+        for (size_t l = 0; l < interpreter.graph().layers.size(); l++) {
+            if (!interpreter.slices(l).empty())
+                std::cout << " " << interpreter.graph().layers[l].name;
+        }
+        std::cout << std::endl;
+        print_latency((std::to_string(t) + " threads").c_str(), measure_latency(run, BENCH_LATENCY_CALLS), single);
+        interpreter.set_pool(nullptr);
+    }
+}
+
+// Times every Conv1D variant on the activations each convolution of the model actually receives
+static void bench_conv_variants(const Graph &graph, const std::vector<number_t> &inputs) {
+    auto layer_inputs = record_layer_inputs(graph, inputs);
+    const size_t count = inputs.size() / graph.input_size();
+
+    for (size_t l = 0; l < graph.layers.size(); l++) {
+        const Layer &layer = graph.layers[l];
+        if (layer.type != LayerType::Conv1D)
+            continue;
+        const auto &in = layer_inputs[l];
+        const auto &expected = layer_inputs[l + 1];
+        const size_t nonzeros = in.size() - std::count(in.begin(), in.end(), 0);
+        std::cout << layer.name << ": " << layer.in_channels << "x" << layer.in_samples << " -> " << layer.out_channels
+                  << "x" << layer.out_samples << ", " << macs(layer) << " MACs, input density " << std::noshowpos
+                  << std::setprecision(3) << static_cast<double>(nonzeros) / in.size() << std::endl;
+
+        TimingStats generic;
+        for (const auto &variant : kernel_variants()) {
+            if (variant.type != LayerType::Conv1D || !variant.supports(layer))
+                continue;
+            Interpreter interpreter(graph);
+            interpreter.select(l, variant.name);
+
+            // The sparse kernel is timed both with its density switch and forced onto the zero-skipping path
+            const bool sparse = variant.run == conv1d_sparse;
+            for (int forced = 0; forced <= (sparse ? 1 : 0); forced++) {
+                if (forced) {
+                    auto *state = static_cast<SparseConvState *>(interpreter.state(l));
+                    state->max_density = 1;
+                    state->stats = SparsityStats();
+                }
+
+                std::vector<number_t> actual(expected.size());
+                for (size_t i = 0; i < count; i++)
+                    interpreter.run_layer(l, &in[i * input_size(layer)], &actual[i * output_size(layer)]);
+                if (actual != expected) {
+                    std::cerr << variant.name << " output differs from generic on " << layer.name << std::endl;
+                    exit(1);
+                }
+
+                size_t next = 0;
+                TimingStats stats;
+                for (size_t round = 0; round < BENCH_ROUNDS; round++) {
+                    keep_best(stats, measure([&] {
+                        size_t i = next++ % count;
+                        interpreter.run_layer(l, &in[i * input_size(layer)], &actual[i * output_size(layer)]);
+                    }, BENCH_REPEATS, BENCH_ITERATIONS));
+                }
+                if (generic.repeats == 0)
+                    generic = stats;
+
+                std::string name = std::string("  ") + variant.name + (forced ? " (forced)" : "");
+                std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+                          << std::setw(10) << stats.min_ns / 1000 << " us, x" << generic.min_ns / stats.min_ns;
+                if (sparse) {
+                    const SparsityStats &s = static_cast<SparseConvState *>(interpreter.state(l))->stats;
+                    std::cout << ", zero-skipping on " << 100 * s.sparse_calls / s.calls << "% of calls";
+                }
+                if (variant.run == conv1d_winograd) {
+                    const auto *state = static_cast<const WinogradConvState *>(interpreter.state(l));
+                    std::cout << ", Winograd on " << 100 * state->winograd_calls / state->calls << "% of calls";
+                }
+                std::cout << std::endl;
+            }
+
+            // Batch path: all recorded inputs in one call, timed per input
+            if (variant.run_batch) {
+                std::vector<long_number_t> scratch(count * variant.scratch_bytes(layer) / sizeof(long_number_t) + 1);
+                std::vector<number_t> actual(expected.size());
+                auto run_batch = [&] {
+                    variant.run_batch(layer, in.data(), actual.data(), count, scratch.data(), interpreter.state(l));
+                };
+                run_batch();
+                if (actual != expected) {
+                    std::cerr << variant.name << " batch output differs from generic on " << layer.name << std::endl;
+                    exit(1);
+                }
+
+                TimingStats stats;
+                for (size_t round = 0; round < BENCH_ROUNDS; round++)
+                    keep_best(stats, measure(run_batch, BENCH_REPEATS, 1));
+                std::string name = std::string("  ") + variant.name + " (batch " + std::to_string(count) + ")";
+                std::cout << std::left << std::setw(20) << name << std::right << std::setw(10) << stats.min_ns / count / 1000
+                          << " us, x" << generic.min_ns * count / stats.min_ns << std::endl;
+            }
+        }
+    }
+}
+
+// Resamples `input` from in_rate to the model rate from a fresh state with the given dot product
+static std::vector<int16_t> resample_all(unsigned int in_rate, const std::vector<int16_t> &coeffs,
+                                         const std::vector<int16_t> &input, resample_dot_fn dot) {
+    std::vector<int16_t> history(2 * resample_taps(in_rate, BENCH_MODEL_RATE));
+    resampler_t resampler;
+    resample_init(&resampler, in_rate, BENCH_MODEL_RATE, coeffs.data(), history.data());
+    std::vector<int16_t> output(resample_max_output(&resampler, input.size()));
+    output.resize(resample_process_with(&resampler, input.data(), input.size(), 1, output.data(), dot));
+    return output;
+}
+
+// Gain in dB of the resampler on a tone, measured after the filter settled
+static double tone_gain_db(unsigned int in_rate, const std::vector<int16_t> &coeffs, double frequency) {
+    const double amplitude = 16000, pi = 3.14159265358979323846;
+    std::vector<int16_t> tone(in_rate);
+    for (size_t i = 0; i < tone.size(); i++)
+        tone[i] = static_cast<int16_t>(std::lround(amplitude * std::sin(2 * pi * frequency * i / in_rate)));
+    const std::vector<int16_t> output = resample_all(in_rate, coeffs, tone, resample_dot);
+    double energy = 0;
+    const size_t settled = output.size() / 4;
+    for (size_t i = settled; i < output.size(); i++)
+        energy += double(output[i]) * output[i];
+    const double rms = std::sqrt(energy / (output.size() - settled));
+    return 20 * std::log10(std::max(rms, 1e-3) / (amplitude / std::sqrt(2.0)));
+}
+
+// Throughput of the front-end resampler from the usual field and I2S rates, SIMD against the portable loop the
+// firmware runs, and its response: passband gain and attenuation of the tones that would alias below 8 kHz
+static void bench_resampler() {
+    const unsigned int rates[] = {48000, 44100, 32000};
+    for (unsigned int rate : rates) {
+        std::vector<int16_t> coeffs(resample_coeff_count(rate, BENCH_MODEL_RATE));
+        resample_design(rate, BENCH_MODEL_RATE, coeffs.data());
+        const std::vector<int16_t> input = random_inputs(1, rate);
+
+        if (resample_all(rate, coeffs, input, resample_dot) != resample_all(rate, coeffs, input, resample_dot_portable)) {
+            std::cerr << "SIMD resampler output differs from the portable one at " << rate << " Hz" << std::endl;
+            exit(1);
+        }
+        TimingStats simd, portable;
+        for (size_t round = 0; round < BENCH_ROUNDS; round++) {
+            keep_best(simd, measure([&] { resample_all(rate, coeffs, input, resample_dot); }, BENCH_REPEATS, 1));
+            keep_best(portable, measure([&] { resample_all(rate, coeffs, input, resample_dot_portable); }, BENCH_REPEATS, 1));
+        }
+        // One second of input per call
+        std::cout << rate << " Hz -> " << BENCH_MODEL_RATE << " Hz, " << resample_taps(rate, BENCH_MODEL_RATE)
+                  << " taps: " << std::fixed << std::setprecision(0) << 1e9 / simd.min_ns << "x real time ("
+                  << 1e9 / portable.min_ns << "x portable)" << std::setprecision(1);
+        std::cout << ", gain 1 kHz " << tone_gain_db(rate, coeffs, 1000) << " dB, 6 kHz " << tone_gain_db(rate, coeffs, 6000)
+                  << " dB, aliasing";
+        for (double frequency : {9000.0, 10000.0, 12000.0, 15000.0, 20000.0}) {
+            if (frequency < rate / 2.0)
+                std::cout << " " << frequency / 1000 << " kHz " << tone_gain_db(rate, coeffs, frequency) << " dB";
+        }
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [testX.csv]" << std::endl;
+        exit(1);
+    }
+
+    const size_t input_size = MODEL_INPUT_CHANNELS * MODEL_INPUT_SAMPLES;
+    std::vector<number_t> inputs;
+    if (argc == 2) {
+        auto rows = readRowsFromFile(argv[1], input_size);
+        size_t count = std::min(rows.size() / input_size, BENCH_INPUTS);
+        inputs.resize(count * input_size);
+        for (size_t i = 0; i < count; i++)
+            convert_input(&rows[i * input_size], MODEL_INPUT_CHANNELS, MODEL_INPUT_SAMPLES, &inputs[i * input_size]);
+    } else {
+        inputs = random_inputs(BENCH_INPUTS, input_size);
+    }
+    const size_t count = inputs.size() / input_size;
+    if (count == 0) {
+        std::cerr << "No input to benchmark" << std::endl;
+        exit(1);
+    }
+    auto input_at = [&](size_t i) {
+        return reinterpret_cast<const number_t(*)[MODEL_INPUT_SAMPLES]>(&inputs[(i % count) * input_size]);
+    };
+
+    Interpreter interpreter(generated_graph());
+
+    // Both paths must agree before their timings mean anything
+    for (size_t i = 0; i < count; i++) {
+        number_t expected[MODEL_OUTPUT_SAMPLES], actual[MODEL_OUTPUT_SAMPLES];
+        cnn(input_at(i), expected);
+        interpreter.run(input_at(i)[0], actual);
+        if (std::memcmp(expected, actual, sizeof(expected)) != 0) {
+            std::cerr << "Interpreter output differs from cnn() on input " << i << std::endl;
+            exit(1);
+        }
+    }
+
+    number_t outputs[MODEL_OUTPUT_SAMPLES];
+    size_t next = 0;
+    TimingStats generated, interpreted;
+    // Alternate both paths so that frequency or load changes on the machine affect them alike
+    for (size_t round = 0; round < BENCH_ROUNDS; round++) {
+        keep_best(generated, measure([&] { cnn(input_at(next++), outputs); }, BENCH_REPEATS, BENCH_ITERATIONS));
+        keep_best(interpreted, measure([&] { interpreter.run(input_at(next++)[0], outputs); }, BENCH_REPEATS, BENCH_ITERATIONS));
+    }
+
+    std::cout << "Model: " << interpreter.graph().layers.size() << " layers, " << interpreter.graph().macs()
+              << " MACs, arena " << interpreter.plan().arena_bytes << " bytes, " << count << " inputs" << std::endl;
+    print_stats("generated cnn()", generated);
+    print_stats("interpreter", interpreted);
+    std::cout << "Interpreter overhead: " << std::showpos << std::setprecision(1)
+              << (interpreted.min_ns / generated.min_ns - 1) * 100 << "%" << std::endl;
+
+    bench_conv_variants(interpreter.graph(), inputs);
+
+    // Keep a variant only where it won, then time the whole model again
+    Interpreter tuned(interpreter.graph());
+    auto choices = select_fastest_kernels(tuned, inputs);
+    std::cout << "Tuned kernels:";
+    for (size_t l = 0; l < choices.size(); l++)
+        std::cout << " " << tuned.graph().layers[l].name << "=" << choices[l].variant;
+    std::cout << std::endl;
+    TimingStats tuned_stats;
+    for (size_t round = 0; round < BENCH_ROUNDS; round++)
+        keep_best(tuned_stats, measure([&] { tuned.run(input_at(next++)[0], outputs); }, BENCH_REPEATS, BENCH_ITERATIONS));
+    print_stats("tuned", tuned_stats);
+
+    // The whole input set as one batch, through the batch paths of the tuned kernels
+    std::vector<number_t> batch_outputs(count * MODEL_OUTPUT_SAMPLES);
+    tuned.run_batch(inputs.data(), batch_outputs.data(), count);
+    for (size_t i = 0; i < count; i++) {
+        interpreter.run(input_at(i)[0], outputs);
+        if (std::memcmp(outputs, &batch_outputs[i * MODEL_OUTPUT_SAMPLES], sizeof(outputs)) != 0) {
+            std::cerr << "Batched output differs from single inference on input " << i << std::endl;
+            exit(1);
+        }
+    }
+    TimingStats batch_stats;
+    for (size_t round = 0; round < BENCH_ROUNDS; round++)
+        keep_best(batch_stats, measure([&] { tuned.run_batch(inputs.data(), batch_outputs.data(), count); }, BENCH_REPEATS, 1));
+    batch_stats.mean_ns /= count;
+    batch_stats.stddev_ns /= count;
+    batch_stats.min_ns /= count;
+    print_stats("tuned, batched", batch_stats);
+
+    std::cout << "Single-input latency:" << std::endl;
+    bench_parallel_latency(tuned, inputs);
+
+    std::cout << "Resampling front-end:" << std::endl;
+    bench_resampler();
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "dataset.h"
+#include "model.h"
+#include "serving.h"
+#include "engine/timing.h"
+
+struct Answer {
+    uint32_t label = 0;
+    uint32_t outputs = 0;
+    double latency_ns = 0;
+};
+
+// Sends windows first, first + stride, ... one at a time over its own connection, like one recorder process
+static void classify_windows(const char *socket_path, const std::vector<number_t> &windows, size_t samples,
+                             size_t first, size_t stride, std::vector<Answer> &answers) {
+    const int fd = connect_unix(socket_path);
+    std::vector<number_t> logits;
+    for (size_t i = first; i < answers.size(); i += stride) {
+        const auto start = std::chrono::steady_clock::now();
+        RequestHeader request = {REQUEST_MAGIC, static_cast<uint32_t>(i), static_cast<uint32_t>(samples)};
+        ResponseHeader response;
+        if (!write_full(fd, &request, sizeof(request)) || !write_full(fd, &windows[i * samples], samples * sizeof(number_t)) ||
+            !read_full(fd, &response, sizeof(response)) || response.magic != RESPONSE_MAGIC || response.id != i)
+            throw std::runtime_error("the daemon closed the connection or sent a bad response");
+        logits.resize(response.logits);
+        if (!read_full(fd, logits.data(), logits.size() * sizeof(number_t)))
+            throw std::runtime_error("the daemon closed the connection");
+        answers[i].label = response.label;
+        answers[i].outputs = response.logits;
+        answers[i].latency_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+    close(fd);
+}
+
+int main(int argc, const char *argv[]) {
+    // "--connections n" sends from n concurrent connections, which the daemon can batch together, "--samples n" sets
+    // the window length when the daemon serves a model with another input size than gsc_output/
+    size_t connections = 1, samples = MODEL_INPUT_CHANNELS * MODEL_INPUT_SAMPLES;
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+        if (std::strcmp(argv[arg], "--connections") == 0)
+            connections = std::max<size_t>(1, std::strtoul(argv[arg + 1], NULL, 10));
+        else if (std::strcmp(argv[arg], "--samples") == 0)
+            samples = std::strtoul(argv[arg + 1], NULL, 10);
+        else
+            break;
+    }
+    if ((argc - arg != 2 && argc - arg != 3) || samples == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--connections n] [--samples n] socket testX.csv [testY.csv]" << std::endl;
+        exit(1);
+    }
+    const char *socket_path = argv[arg];
+
+    // Rows hold raw samples in real units like x_test.csv, sent as the model's fixed-point windows
+    auto rows = readRowsFromFile(argv[arg + 1], samples);
+    const size_t count = rows.size() / samples;
+    std::vector<number_t> windows(count * samples);
+    for (size_t i = 0; i < count; i++)
+        convert_input(&rows[i * samples], 1, samples, &windows[i * samples]);
+
+    std::vector<Answer> answers(count);
+    std::vector<std::thread> threads;
+    std::vector<std::string> errors(connections);
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < connections; c++) {
+        threads.emplace_back([&, c] {
+            try {
+                classify_windows(socket_path, windows, samples, c, connections, answers);
+            } catch (const std::exception &e) {
+                errors[c] = e.what();
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const std::string &error : errors) {
+        if (!error.empty()) {
+            std::cerr << "Error: " << error << std::endl;
+            exit(1);
+        }
+    }
+
+    std::vector<double> latencies;
+    for (const Answer &answer : answers) {
+        std::cout << answer.label << std::endl;
+        latencies.push_back(answer.latency_ns);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::cerr << count << " windows over " << connections << " connection(s): " << count / seconds
+              << " windows/s, latency p50 " << percentile(latencies, 0.5) / 1000 << " us, p99 "
+              << percentile(latencies, 0.99) / 1000 << " us" << std::endl;
+
+    if (argc - arg == 3 && count > 0) {
+        const size_t outputs = answers[0].outputs;
+        auto labels = readRowsFromFile(argv[arg + 2], outputs);
+        int rightlabels = 0;
+        for (size_t i = 0; i < count && i < labels.size() / outputs; i++) {
+            if (labels[i * outputs + answers[i].label] > 0)
+                rightlabels++;
+        }
+        std::cerr << "Testing accuracy: " << rightlabels / static_cast<float>(count) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "dataset.h"
+#include "wav.h"
+#include "engine/graph.h"
+#include "engine/model_set.h"
+
+static bool ends_with(const std::string &text, const std::string &suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, const char *argv[]) {
+    // Candidates are the leading .gscg arguments (run_graph --export of each retrained gsc_output/), the test set
+    // follows: x/y CSV files, a binary dataset or a directory of recordings like run_graph takes
+    int models = 1;
+    while (models < argc && ends_with(argv[models], ".gscg"))
+        models++;
+    const int data = argc - models;
+    if (models == 1 || data < 1 || data > 2) {
+        std::cerr << "Usage: " << argv[0] << " a.gscg b.gscg... x_test.csv y_test.csv" << std::endl;
+        std::cerr << "       " << argv[0] << " a.gscg b.gscg... dataset.gscd | recordings/" << std::endl;
+        exit(1);
+    }
+
+    try {
+        std::vector<Graph> graphs;
+        for (int m = 1; m < models; m++)
+            graphs.push_back(Graph::load(argv[m]));
+        const Graph &graph = graphs[0];
+        for (size_t c = 1; c < graphs.size(); c++) {
+            if (graphs[c].output_size() != graph.output_size())
+                throw std::runtime_error(std::string(argv[c + 1]) + " has " + std::to_string(graphs[c].output_size()) +
+                                         " outputs instead of " + std::to_string(graph.output_size()));
+        }
+        ModelSet set(graphs);
+
+        // Every input is read once, in the model layout, with the index of its class
+        std::vector<number_t> converted;
+        std::vector<size_t> classes;
+        std::unique_ptr<BinaryDataset> binary;
+        const number_t *inputs;
+        struct stat st;
+        if (data == 2) {
+            const std::vector<float> rows = readRowsFromFile(argv[models], graph.input_size());
+            const std::vector<float> labels = readRowsFromFile(argv[models + 1], graph.output_size());
+            const size_t count = std::min(rows.size() / graph.input_size(), labels.size() / graph.output_size());
+            converted.resize(count * graph.input_size());
+            for (size_t i = 0; i < count; i++) {
+                convert_input(&rows[i * graph.input_size()], graph.input_channels, graph.input_samples, &converted[i * graph.input_size()]);
+                classes.push_back(std::max_element(&labels[i * graph.output_size()], &labels[(i + 1) * graph.output_size()]) -
+                                  &labels[i * graph.output_size()]);
+            }
+            inputs = converted.data();
+        } else if (stat(argv[models], &st) == 0 && S_ISDIR(st.st_mode)) {
+            WavDataset dataset = load_wav_dataset(argv[models], {}, graph.input_size(), std::max(1u, std::thread::hardware_concurrency()));
+            converted = std::move(dataset.inputs);
+            for (size_t i = 0; i < dataset.paths.size(); i++)
+                classes.push_back(std::max_element(&dataset.labels[i * dataset.classes.size()], &dataset.labels[(i + 1) * dataset.classes.size()]) -
+                                  &dataset.labels[i * dataset.classes.size()]);
+            inputs = converted.data();
+        } else {
+            binary.reset(new BinaryDataset(argv[models]));
+            if (binary->samples() != graph.input_size())
+                throw std::runtime_error("windows of " + std::to_string(binary->samples()) + " samples for models taking " +
+                                         std::to_string(graph.input_size()));
+            classes.assign(binary->labels(), binary->labels() + binary->windows());
+            inputs = binary->inputs();
+        }
+        if (classes.empty())
+            throw std::runtime_error("no test inputs");
+
+        // One pass over the inputs runs every candidate, shared prefixes once
+        std::vector<size_t> correct(set.size()), labels(set.size());
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < classes.size(); i++) {
+            set.classify(&inputs[i * graph.input_size()], labels.data());
+            for (size_t c = 0; c < set.size(); c++)
+                correct[c] += labels[c] == classes[i];
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t width = 5;
+        for (int m = 1; m < models; m++)
+            width = std::max(width, std::strlen(argv[m]));
+        std::cout << std::left << std::setw(width + 2) << "model" << std::right << std::setw(10) << "accuracy" << std::setw(12)
+                  << "alone us" << std::setw(12) << "share us" << std::setw(16) << "shared layers" << std::endl;
+        std::cout << std::fixed;
+        for (size_t c = 0; c < set.size(); c++) {
+            std::cout << std::left << std::setw(width + 2) << argv[c + 1] << std::right << std::setprecision(4) << std::setw(10)
+                      << correct[c] / double(classes.size()) << std::setprecision(1) << std::setw(12) << set.alone_ns(c) / 1000
+                      << std::setw(12) << set.share_ns(c) / 1000 << std::setw(16)
+                      << (std::to_string(set.shared_layers(c)) + "/" + std::to_string(graphs[c].layers.size())) << std::endl;
+        }
+        std::cout.unsetf(std::ios::fixed);
+        std::cerr << classes.size() << " inputs in " << seconds * 1000 << " ms, " << set.layer_runs() << " layer runs per input instead of "
+                  << set.separate_layer_runs() << " evaluating the models one by one" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include "dataset.h"
+#include "ring.h"
+#include "serving.h"
+#include "engine/graph.h"
+#include "engine/head.h"
+#include "engine/interpreter.h"
+#include "engine/timing.h"
+#include "engine/tuning.h"
+
+static const size_t DAEMON_MAX_BATCH = 8;
+static const long DAEMON_MAX_WAIT_US = 2000;
+static const size_t DAEMON_WORKERS = 1;
+static const long DAEMON_STATS_INTERVAL_S = 10;
+static const size_t DAEMON_LATENCY_WINDOW = 100000; // Latencies kept between reports, the most recent ones
+static const uint32_t DAEMON_RING_SLOTS = 64;
+static const long DAEMON_ACCEPT_BACKOFF_MAX_MS = 1000; // Longest pause after accept() failures like EMFILE
+
+typedef std::chrono::steady_clock Clock;
+
+// One client connection, closed once its reader and every pending request released it
+struct Connection {
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() {
+        close(fd);
+    }
+
+    const int fd;
+    std::mutex write_mutex; // Responses of concurrent batches must not interleave
+};
+
+struct Request {
+    std::shared_ptr<Connection> connection;
+    uint32_t id;
+    std::vector<number_t> samples;
+    Clock::time_point arrival; // When the whole request was read
+};
+
+// Counters reported by the daemon. Batch sizes and queue depths accumulate over its lifetime, latencies over the
+// requests answered since the previous report (at most DAEMON_LATENCY_WINDOW of them).
+class DaemonStats {
+public:
+    explicit DaemonStats(size_t max_batch) : batch_sizes_(max_batch + 1) {}
+
+    // `depth` is the queue length when the batch was formed, the batch included
+    void record_batch(size_t size, size_t depth) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch_sizes_[size]++;
+        batches_++;
+        depth_sum_ += depth;
+        depth_max_ = std::max(depth_max_, depth);
+    }
+
+    void record_latency(double ns) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (latencies_.size() < DAEMON_LATENCY_WINDOW)
+            latencies_.push_back(ns);
+        else
+            latencies_[requests_ % DAEMON_LATENCY_WINDOW] = ns;
+        requests_++;
+    }
+
+    void report(std::ostream &out, size_t depth) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << std::fixed << std::setprecision(1) << "[stats] " << requests_ << " requests in " << batches_
+            << " batches, queue depth " << depth << " (mean " << (batches_ ? double(depth_sum_) / batches_ : 0.0)
+            << ", max " << depth_max_ << " when forming a batch)" << std::endl;
+        out << "[stats] batch sizes:";
+        for (size_t size = 1; size < batch_sizes_.size(); size++) {
+            if (batch_sizes_[size])
+                out << " " << size << "x" << batch_sizes_[size];
+        }
+        out << std::endl;
+        std::sort(latencies_.begin(), latencies_.end());
+        out << "[stats] latency over the last " << latencies_.size() << " requests: p50 "
+            << percentile(latencies_, 0.5) / 1000 << " us, p99 " << percentile(latencies_, 0.99) / 1000 << " us"
+            << std::endl;
+        out.unsetf(std::ios::fixed);
+        latencies_.clear();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<size_t> batch_sizes_; // Number of batches of each size
+    size_t batches_ = 0, requests_ = 0;
+    size_t depth_sum_ = 0, depth_max_ = 0;
+    std::vector<double> latencies_;
+};
+
+// Requests waiting for a worker. A batch is due once max_batch requests wait or the oldest one waited max_wait, so
+// that a lone request is never held longer than that while concurrent ones share a run_batch() call.
+class BatchQueue {
+public:
+    BatchQueue(size_t max_batch, std::chrono::microseconds max_wait, DaemonStats &stats)
+        : max_batch_(max_batch), max_wait_(max_wait), stats_(stats) {}
+
+    void push(Request request) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            requests_.push_back(std::move(request));
+        }
+        changed_.notify_all();
+    }
+
+    std::vector<Request> pop_batch() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // Re-evaluated on every wake-up, since another worker may have taken the oldest requests in the meantime
+        for (;;) {
+            changed_.wait(lock, [&] { return !requests_.empty(); });
+            const Clock::time_point deadline = requests_.front().arrival + max_wait_;
+            if (requests_.size() >= max_batch_ || Clock::now() >= deadline)
+                break;
+            changed_.wait_until(lock, deadline);
+        }
+
+        const size_t size = std::min(requests_.size(), max_batch_);
+        stats_.record_batch(size, requests_.size());
+        std::vector<Request> batch;
+        for (size_t i = 0; i < size; i++) {
+            batch.push_back(std::move(requests_.front()));
+            requests_.pop_front();
+        }
+        return batch;
+    }
+
+    size_t depth() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_.size();
+    }
+
+private:
+    const size_t max_batch_;
+    const std::chrono::microseconds max_wait_;
+    DaemonStats &stats_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<Request> requests_;
+};
+
+// Reads requests until the client closes the connection or sends a malformed one
+static void read_requests(std::shared_ptr<Connection> connection, size_t samples, BatchQueue &queue) {
+    for (;;) {
+        RequestHeader header;
+        if (!read_full(connection->fd, &header, sizeof(header)))
+            break;
+        if (header.magic != REQUEST_MAGIC || header.samples != samples) {
+            std::cerr << "Closing a connection: bad request (magic " << header.magic << ", " << header.samples
+                      << " samples instead of " << samples << ")" << std::endl;
+            break;
+        }
+        Request request;
+        request.connection = connection;
+        request.id = header.id;
+        request.samples.resize(samples);
+        if (!read_full(connection->fd, request.samples.data(), samples * sizeof(number_t)))
+            break;
+        request.arrival = Clock::now();
+        queue.push(std::move(request));
+    }
+    shutdown(connection->fd, SHUT_RD);
+}
+
+// One worker: its own interpreter and batch buffers, so workers never share a workspace
+static void serve_batches(Interpreter &interpreter, BatchQueue &queue, DaemonStats &stats) {
+    const size_t input_size = interpreter.graph().input_size(), output_size = interpreter.graph().output_size();
+    std::vector<number_t> inputs, outputs;
+    for (;;) {
+        std::vector<Request> batch = queue.pop_batch();
+        inputs.resize(batch.size() * input_size);
+        outputs.resize(batch.size() * output_size);
+        for (size_t i = 0; i < batch.size(); i++)
+            std::copy(batch[i].samples.begin(), batch[i].samples.end(), &inputs[i * input_size]);
+        interpreter.run_batch(inputs.data(), outputs.data(), batch.size());
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            const number_t *logits = &outputs[i * output_size];
+            ResponseHeader header = {RESPONSE_MAGIC, batch[i].id, static_cast<uint32_t>(argmax(logits, output_size).label),
+                                     static_cast<uint32_t>(output_size)};
+            {
+                std::lock_guard<std::mutex> lock(batch[i].connection->write_mutex);
+                // A client that went away only loses its own answers
+                if (write_full(batch[i].connection->fd, &header, sizeof(header)))
+                    write_full(batch[i].connection->fd, logits, output_size * sizeof(number_t));
+            }
+            stats.record_latency(std::chrono::duration<double, std::nano>(Clock::now() - batch[i].arrival).count());
+        }
+    }
+}
+
+// Consumer of the shared-memory ring, with an interpreter of its own: runs every batch of consecutive published
+// windows in place, without waiting for more since producers already queue in the ring
+static void serve_ring(Interpreter &interpreter, WindowRing &ring, size_t max_batch, DaemonStats &stats) {
+    const size_t output_size = interpreter.graph().output_size();
+    std::vector<uint32_t> labels(max_batch);
+    uint64_t reclaimed = 0;
+    for (uint64_t head = 0;;) {
+        const size_t count = ring.wait_ready(head, max_batch);
+        if (ring.reclaimed() != reclaimed) {
+            std::cerr << "Freed " << ring.reclaimed() - reclaimed << " ring slots of exited or timed out producers" << std::endl;
+            reclaimed = ring.reclaimed();
+        }
+        stats.record_batch(count, static_cast<size_t>(ring.claimed() - head));
+        interpreter.run_batch(ring.window(head), ring.result(head), count);
+        const int64_t now = monotonic_ns();
+        for (size_t i = 0; i < count; i++) {
+            labels[i] = static_cast<uint32_t>(argmax(ring.result(head + i), output_size).label);
+            stats.record_latency(static_cast<double>(now - ring.published_ns(head + i)));
+        }
+        ring.complete(head, count, labels.data());
+        head += count;
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    // "--max-batch n" and "--max-wait-us us" bound the micro-batches, "--workers n" runs that many interpreters,
+    // "--stats-interval s" prints the statistics every s seconds (0: only on exit), "--tune-cache file" selects the
+    // kernels tuned for this CPU and model like run_graph does, "--ring name" also serves the shared memory ring
+    // `name` (like /gsc_ring) of "--ring-slots n" windows with one more interpreter. Ring slots of exited producers
+    // are freed; "--ring-timeout-s s" also frees those live producers hold for more than s seconds (0: never).
+    size_t max_batch = DAEMON_MAX_BATCH, workers = DAEMON_WORKERS;
+    long max_wait_us = DAEMON_MAX_WAIT_US, stats_interval = DAEMON_STATS_INTERVAL_S;
+    const char *cache = nullptr, *ring_name = nullptr;
+    uint32_t ring_slots = DAEMON_RING_SLOTS;
+    double ring_timeout_s = 0;
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+        if (std::strcmp(argv[arg], "--max-batch") == 0)
+            max_batch = std::strtoul(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--max-wait-us") == 0)
+            max_wait_us = std::strtol(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--workers") == 0)
+            workers = std::strtoul(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--stats-interval") == 0)
+            stats_interval = std::strtol(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--tune-cache") == 0)
+            cache = argv[arg + 1];
+        else if (std::strcmp(argv[arg], "--ring") == 0)
+            ring_name = argv[arg + 1];
+        else if (std::strcmp(argv[arg], "--ring-slots") == 0)
+            ring_slots = static_cast<uint32_t>(std::strtoul(argv[arg + 1], NULL, 10));
+        else if (std::strcmp(argv[arg], "--ring-timeout-s") == 0)
+            ring_timeout_s = std::strtod(argv[arg + 1], NULL);
+        else
+            break;
+    }
+    if (argc - arg != 2 || max_batch == 0 || workers == 0 || max_wait_us < 0 || ring_timeout_s < 0) {
+        std::cerr << "Usage: " << argv[0] << " [--max-batch n] [--max-wait-us us] [--workers n] [--stats-interval s]"
+                  << " [--tune-cache file] [--ring name] [--ring-slots n] [--ring-timeout-s s] model.gscg socket" << std::endl;
+        exit(1);
+    }
+    const char *socket_path = argv[arg + 1];
+
+    // Only the main thread takes SIGINT/SIGTERM, through sigwait() below
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    DaemonStats stats(max_batch);
+    BatchQueue queue(max_batch, std::chrono::microseconds(max_wait_us), stats);
+    std::vector<std::unique_ptr<Interpreter>> interpreters;
+    std::unique_ptr<WindowRing> ring;
+    int listen_fd;
+    try {
+        const Graph graph = Graph::load(argv[arg]);
+        // The ring's interpreter is the last one
+        const size_t count = workers + (ring_name ? 1 : 0);
+        for (size_t w = 0; w < count; w++) {
+            interpreters.emplace_back(new Interpreter(graph));
+            if (!cache)
+                continue;
+            if (w == 0) {
+                const bool hit = tune_kernels_cached(*interpreters[0], random_inputs(TUNE_INPUTS, graph.input_size()), cache);
+                std::cerr << (hit ? "Kernels loaded from " : "Kernels tuned and stored in ") << cache << std::endl;
+            }
+            for (size_t l = 0; l < graph.layers.size(); l++)
+                interpreters[w]->select(l, interpreters[0]->kernels()[l]->name);
+        }
+        listen_fd = listen_unix(socket_path);
+        if (ring_name) {
+            ring.reset(new WindowRing(WindowRing::create(ring_name, ring_slots, static_cast<uint32_t>(graph.input_size()),
+                                                         static_cast<uint32_t>(graph.output_size()))));
+            ring->set_timeout(static_cast<int64_t>(ring_timeout_s * 1e9));
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+    const size_t samples = interpreters[0]->graph().input_size();
+
+    for (size_t w = 0; w < workers; w++)
+        std::thread(serve_batches, std::ref(*interpreters[w]), std::ref(queue), std::ref(stats)).detach();
+    if (ring)
+        std::thread(serve_ring, std::ref(*interpreters.back()), std::ref(*ring), max_batch, std::ref(stats)).detach();
+    std::thread([&] {
+        // Persistent failures (out of descriptors) are logged once and retried after a pause doubling up to
+        // DAEMON_ACCEPT_BACKOFF_MAX_MS, instead of spinning on a core until a connection closes
+        long backoff_ms = 0;
+        for (;;) {
+            const int fd = accept(listen_fd, NULL, NULL);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                if (backoff_ms == 0)
+                    std::cerr << "accept() failed: " << std::strerror(errno) << ", retrying" << std::endl;
+                backoff_ms = std::min(std::max(2 * backoff_ms, 10L), DAEMON_ACCEPT_BACKOFF_MAX_MS);
+                std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+                continue;
+            }
+            if (backoff_ms != 0)
+                std::cerr << "accept() recovered" << std::endl;
+            backoff_ms = 0;
+            std::thread(read_requests, std::make_shared<Connection>(fd), samples, std::ref(queue)).detach();
+        }
+    }).detach();
+    if (stats_interval > 0) {
+        std::thread([&] {
+            for (;;) {
+                std::this_thread::sleep_for(std::chrono::seconds(stats_interval));
+                stats.report(std::cerr, queue.depth());
+            }
+        }).detach();
+    }
+
+    std::cerr << "Serving " << interpreters[0]->graph().layers.size() << "-layer model on " << socket_path << ", "
+              << workers << " worker(s), batches of up to " << max_batch << " within " << max_wait_us << " us" << std::endl;
+    if (ring)
+        std::cerr << "Serving the shared memory ring " << ring_name << " of " << ring_slots << " windows" << std::endl;
+    int signal;
+    sigwait(&signals, &signal);
+    stats.report(std::cerr, queue.depth());
+    unlink(socket_path);
+    if (ring_name)
+        shm_unlink(ring_name);
+    // The other threads block in accept(), read() or the queue; leave without tearing down what they use
+    std::_Exit(0);
+}
@@ -0,0 +1,166 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "number.h"
+
+// Reads a CSV file whose rows all have `columns` float values into one flat row-major vector
+inline std::vector<float> readRowsFromFile(const char *filename, size_t columns) {
+    std::vector<float> values;
+
+    std::ifstream fin(filename);
+    if (!fin) {
+        std::cerr << "Error opening \"" << filename << "\": " << strerror(errno) << std::endl;
+        exit(1);
+    }
+
+    std::string linestr;
+    for (size_t row = 0; std::getline(fin, linestr); row++) {
+        std::istringstream linestrs(linestr);
+        std::string floatstr;
+        size_t i = 0;
+        for (; std::getline(linestrs, floatstr, ','); i++) {
+            if (i >= columns)
+                break;
+            values.push_back(std::strtof(floatstr.c_str(), NULL));
+        }
+        if (i != columns) {
+            std::cerr << "Error in \"" << filename << "\": row " << row << " does not have " << columns << " values" << std::endl;
+            exit(1);
+        }
+    }
+    return values;
+}
+
+// Converts one samples-first float row to the model's channels-first fixed-point layout
+inline void convert_input(const float *input, size_t channels, size_t samples, number_t *out) {
+    for (size_t i = 0; i < channels; i++) {
+        for (size_t j = 0; j < samples; j++) {
+            out[i * samples + j] = clamp_to_number_t((long_number_t)(input[j * channels + i] * (1 << FIXED_POINT)));
+        }
+    }
+}
+
+// Deterministic fixed-point inputs with roughly the spread of normalized audio, for benchmarks without x_test.csv
+inline std::vector<number_t> random_inputs(size_t count, size_t size, unsigned seed = 42) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<number_t> values(count * size);
+    for (auto &value : values)
+        value = clamp_to_number_t((long_number_t)(dist(rng) * (1 << FIXED_POINT)));
+    return values;
+}
+
+// Binary dataset file: magic, u16 version, u16 class count, u32 samples per window, u64 window count, then the windows
+// as number_t values back to back and a u16 class index per window. Mapped, it needs no parsing and no memory of its
+// own, for test sets far larger than the CSV files.
+static const char BINARY_DATASET_MAGIC[4] = {'G', 'S', 'C', 'D'};
+static const uint16_t BINARY_DATASET_VERSION = 1;
+static const size_t BINARY_DATASET_HEADER = 20;
+
+inline void write_binary_dataset_header(std::ostream &out, size_t classes, size_t samples, uint64_t windows) {
+    const uint16_t version = BINARY_DATASET_VERSION, class_count = static_cast<uint16_t>(classes);
+    const uint32_t sample_count = static_cast<uint32_t>(samples);
+    out.write(BINARY_DATASET_MAGIC, sizeof(BINARY_DATASET_MAGIC));
+    out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char *>(&class_count), sizeof(class_count));
+    out.write(reinterpret_cast<const char *>(&sample_count), sizeof(sample_count));
+    out.write(reinterpret_cast<const char *>(&windows), sizeof(windows));
+}
+
+class BinaryDataset {
+public:
+    explicit BinaryDataset(const std::string &path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open \"" + path + "\": " + std::strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(BINARY_DATASET_HEADER)) {
+            close(fd);
+            throw std::runtime_error("\"" + path + "\" is not a binary dataset");
+        }
+        bytes_ = static_cast<size_t>(st.st_size);
+        void *base = mmap(NULL, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+            throw std::runtime_error("cannot map \"" + path + "\": " + std::strerror(errno));
+        base_ = static_cast<const char *>(base);
+
+        uint16_t version, classes;
+        uint32_t samples;
+        std::memcpy(&version, base_ + 4, sizeof(version));
+        std::memcpy(&classes, base_ + 6, sizeof(classes));
+        std::memcpy(&samples, base_ + 8, sizeof(samples));
+        std::memcpy(&windows_, base_ + 12, sizeof(windows_));
+        classes_ = classes;
+        samples_ = samples;
+        std::string error;
+        if (std::memcmp(base_, BINARY_DATASET_MAGIC, sizeof(BINARY_DATASET_MAGIC)) != 0)
+            error = "\"" + path + "\" is not a binary dataset";
+        else if (version != BINARY_DATASET_VERSION)
+            error = "unsupported binary dataset version";
+        else if (samples_ == 0)
+            error = "binary dataset of empty windows";
+        else if (windows_ > (bytes_ - BINARY_DATASET_HEADER) / (samples_ * sizeof(number_t) + sizeof(uint16_t)))
+            error = "truncated binary dataset"; // Divided, so that no header can make the size wrap
+        for (uint64_t i = 0; error.empty() && i < windows_; i++)
+            if (labels()[i] >= classes_)
+                error = "class " + std::to_string(labels()[i]) + " of window " + std::to_string(i) + " in \"" + path +
+                        "\" is not one of its " + std::to_string(classes_) + " classes";
+        if (!error.empty()) {
+            munmap(const_cast<char *>(base_), bytes_);
+            throw std::runtime_error(error);
+        }
+    }
+
+    BinaryDataset(const BinaryDataset &) = delete;
+    BinaryDataset &operator=(const BinaryDataset &) = delete;
+
+    ~BinaryDataset() {
+        munmap(const_cast<char *>(base_), bytes_);
+    }
+
+    size_t classes() const {
+        return classes_;
+    }
+
+    size_t samples() const {
+        return samples_;
+    }
+
+    size_t windows() const {
+        return windows_;
+    }
+
+    // windows() windows of samples() values
+    const number_t *inputs() const {
+        return reinterpret_cast<const number_t *>(base_ + BINARY_DATASET_HEADER);
+    }
+
+    // Class index of each window, below classes()
+    const uint16_t *labels() const {
+        return reinterpret_cast<const uint16_t *>(base_ + BINARY_DATASET_HEADER + windows_ * samples_ * sizeof(number_t));
+    }
+
+private:
+    const char *base_ = nullptr;
+    size_t bytes_ = 0, classes_ = 0, samples_ = 0;
+    uint64_t windows_ = 0;
+};
+
+#endif // DATASET_H
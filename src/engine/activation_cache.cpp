@@ -0,0 +1,193 @@
+#include "activation_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CACHE_MAGIC[4] = {'G', 'S', 'C', 'A'};
+static const uint16_t CACHE_VERSION = 1;
+static const size_t CACHE_HEADER = 8;
+static const size_t CACHE_RECORD_HEADER = 16;
+
+static uint64_t mix(uint64_t hash) {
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+// Inputs are hashed a word at a time: byte-wise FNV-1a over a whole window would cost more than the layers a cache
+// hit saves on the head
+static uint64_t hash_input(const number_t *values, size_t count) {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(values);
+    const size_t bytes = count * sizeof(number_t);
+    uint64_t hash = mix(bytes);
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, sizeof(word));
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < bytes; i++)
+        hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    return mix(hash);
+}
+
+static void write_all(int fd, const void *data, size_t bytes, const std::string &path) {
+    const char *p = static_cast<const char *>(data);
+    while (bytes > 0) {
+        const ssize_t written = write(fd, p, bytes);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            throw std::runtime_error("error writing \"" + path + "\": " + std::strerror(errno));
+        p += written;
+        bytes -= static_cast<size_t>(written);
+    }
+}
+
+ActivationCache::ActivationCache(const std::string &path, const Graph &graph)
+    : path_(path), prefix_hashes_(graph.prefix_hashes()) {
+    size_t largest = 0;
+    for (const Layer &layer : graph.layers)
+        largest = std::max(largest, output_size(layer));
+    buffers_[0].resize(largest);
+    buffers_[1].resize(largest);
+    resumed_.assign(graph.layers.size() + 1, 0);
+
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0)
+        throw std::runtime_error("cannot open \"" + path + "\": " + std::strerror(errno));
+    try {
+        if (flock(fd_, LOCK_EX) != 0)
+            throw std::runtime_error("cannot lock \"" + path + "\": " + std::strerror(errno));
+        struct stat st;
+        if (fstat(fd_, &st) != 0)
+            throw std::runtime_error("cannot stat \"" + path + "\": " + std::strerror(errno));
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ == 0) {
+            char file_header[CACHE_HEADER] = {};
+            std::memcpy(file_header, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+            std::memcpy(file_header + 4, &CACHE_VERSION, sizeof(CACHE_VERSION));
+            file_header[6] = FIXED_POINT;
+            write_all(fd_, file_header, sizeof(file_header), path);
+            size_ = CACHE_HEADER;
+        }
+        map();
+
+        uint16_t version = 0;
+        if (size_ >= CACHE_HEADER)
+            std::memcpy(&version, base_ + 4, sizeof(version));
+        if (size_ < CACHE_HEADER || std::memcmp(base_, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+            throw std::runtime_error("\"" + path + "\" is not an activation cache");
+        if (version != CACHE_VERSION)
+            throw std::runtime_error("unsupported activation cache version");
+        if (base_[6] != FIXED_POINT)
+            throw std::runtime_error("activation cache fixed point format differs from this build's FIXED_POINT");
+
+        size_t offset = CACHE_HEADER;
+        while (offset + CACHE_RECORD_HEADER <= size_) {
+            uint64_t key;
+            uint32_t count;
+            std::memcpy(&key, base_ + offset, sizeof(key));
+            std::memcpy(&count, base_ + offset + 8, sizeof(count));
+            const size_t end = offset + CACHE_RECORD_HEADER + count * sizeof(number_t);
+            if (end > size_)
+                break;
+            index_[key] = {offset + CACHE_RECORD_HEADER, count};
+            offset = end;
+        }
+        if (offset != size_) {
+            if (ftruncate(fd_, static_cast<off_t>(offset)) != 0)
+                throw std::runtime_error("cannot truncate \"" + path + "\": " + std::strerror(errno));
+            size_ = offset;
+        }
+    } catch (...) {
+        if (base_)
+            munmap(const_cast<char *>(base_), mapped_);
+        close(fd_);
+        throw;
+    }
+}
+
+ActivationCache::~ActivationCache() {
+    if (base_)
+        munmap(const_cast<char *>(base_), mapped_);
+    close(fd_); // Releases the lock
+}
+
+void ActivationCache::map() {
+    if (base_)
+        munmap(const_cast<char *>(base_), mapped_);
+    base_ = nullptr;
+    mapped_ = 0;
+    void *base = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED)
+        throw std::runtime_error("cannot map \"" + path_ + "\": " + std::strerror(errno));
+    base_ = static_cast<const char *>(base);
+    mapped_ = size_;
+}
+
+const number_t *ActivationCache::find(uint64_t key, size_t count) {
+    const auto it = index_.find(key);
+    if (it == index_.end() || it->second.count != count)
+        return nullptr;
+    if (it->second.offset + count * sizeof(number_t) > mapped_)
+        map();
+    return reinterpret_cast<const number_t *>(base_ + it->second.offset);
+}
+
+void ActivationCache::store(uint64_t key, const number_t *values, size_t count) {
+    char header[CACHE_RECORD_HEADER] = {};
+    const uint32_t count32 = static_cast<uint32_t>(count);
+    std::memcpy(header, &key, sizeof(key));
+    std::memcpy(header + 8, &count32, sizeof(count32));
+    write_all(fd_, header, sizeof(header), path_);
+    write_all(fd_, values, count * sizeof(number_t), path_);
+    index_[key] = {size_ + CACHE_RECORD_HEADER, count};
+    size_ += CACHE_RECORD_HEADER + count * sizeof(number_t);
+}
+
+Classification ActivationCache::classify(Interpreter &interpreter, const number_t *input, number_t *logits) {
+    const Graph &graph = interpreter.graph();
+    const size_t layers = graph.layers.size();
+    const uint64_t input_hash = hash_input(input, graph.input_size());
+    auto key = [&](size_t layer) { return mix(input_hash ^ mix(prefix_hashes_[layer])); };
+
+    // Deepest cached output, Flatten outputs being those of the layer before
+    const number_t *in = input;
+    size_t start = 0;
+    for (size_t l = layers; l-- > 0;) {
+        if (graph.layers[l].type == LayerType::Flatten)
+            continue;
+        if (const number_t *cached = find(key(l), output_size(graph.layers[l]))) {
+            in = cached;
+            start = l + 1;
+            break;
+        }
+    }
+    resumed_[start == 0 ? layers : start - 1]++;
+    layers_skipped_ += start;
+
+    size_t next = 0;
+    for (size_t l = start; l < layers; l++) {
+        if (graph.layers[l].type == LayerType::Flatten)
+            continue; // Channels-first data is already flat
+        number_t *out = buffers_[next].data();
+        next ^= 1;
+        interpreter.run_layer(l, in, out);
+        store(key(l), out, output_size(graph.layers[l]));
+        in = out;
+        layers_run_++;
+    }
+    if (logits)
+        std::copy_n(in, graph.output_size(), logits);
+    return argmax(in, graph.output_size());
+}
@@ -0,0 +1,71 @@
+#ifndef ENGINE_ACTIVATION_CACHE_H
+#define ENGINE_ACTIVATION_CACHE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "interpreter.h"
+
+// On-disk cache of layer outputs, for re-evaluating a test set after retraining only the last layers. The output of
+// layer l for an input is keyed by a hash of the input and of the shapes and weights of layers 0 to l, so an entry
+// stays valid exactly as long as nothing upstream of it changed. Classifying resumes from the deepest cached output
+// and caches the outputs of every layer it runs (all but Flatten, about 13k values per input for the GSC model).
+//
+// The file is append-only: "GSCA", u16 version, u8 FIXED_POINT, u8 reserved, then records of a u64 key, a u32 value
+// count, a u32 reserved and the values. It is mapped read-only and indexed when opened, records added during the run
+// are appended with write() and mapped again only if they are looked up; a truncated last record (an interrupted
+// run) is dropped. One process at a time holds the file, others wait on its lock.
+class ActivationCache {
+public:
+    ActivationCache(const std::string &path, const Graph &graph);
+    ~ActivationCache();
+    ActivationCache(const ActivationCache &) = delete;
+    ActivationCache &operator=(const ActivationCache &) = delete;
+
+    // Classifies `input` with `interpreter`, whose graph must be the one the cache was opened for
+    Classification classify(Interpreter &interpreter, const number_t *input, number_t *logits = nullptr);
+
+    // Inputs that resumed after each layer, the last entry counting those computed from the input
+    const std::vector<size_t> &resumed() const {
+        return resumed_;
+    }
+
+    size_t layers_run() const {
+        return layers_run_;
+    }
+
+    size_t layers_skipped() const {
+        return layers_skipped_;
+    }
+
+    size_t records() const {
+        return index_.size();
+    }
+
+    size_t bytes() const {
+        return size_;
+    }
+
+private:
+    struct Entry {
+        size_t offset; // Of the values in the file
+        size_t count;
+    };
+
+    const number_t *find(uint64_t key, size_t count);
+    void store(uint64_t key, const number_t *values, size_t count);
+    void map();
+
+    std::string path_;
+    int fd_ = -1;
+    const char *base_ = nullptr;
+    size_t mapped_ = 0, size_ = 0;
+    std::unordered_map<uint64_t, Entry> index_;
+    std::vector<uint64_t> prefix_hashes_; // Graph::prefix_hashes()
+    std::vector<number_t> buffers_[2];
+    std::vector<size_t> resumed_;
+    size_t layers_run_ = 0, layers_skipped_ = 0;
+};
+
+#endif // ENGINE_ACTIVATION_CACHE_H
@@ -0,0 +1,189 @@
+#include "counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *counter_name(HardwareCounter counter) {
+    switch (counter) {
+        case HardwareCounter::Cycles:
+            return "cycles";
+        case HardwareCounter::Instructions:
+            return "instructions";
+        case HardwareCounter::L1DMisses:
+            return "L1D misses";
+        case HardwareCounter::LLCMisses:
+            return "LLC misses";
+        case HardwareCounter::BranchMisses:
+            return "branch misses";
+    }
+    return "unknown";
+}
+
+void CounterTotals::add(const CounterSample &sample, size_t sample_calls) {
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        sum.values[c] += sample.values[c];
+        sum.valid[c] = sample.valid[c] && (samples == 0 || sum.valid[c]);
+    }
+    samples++;
+    calls += sample_calls;
+}
+
+double CounterTotals::ipc() const {
+    if (!sum.has(HardwareCounter::Cycles) || !sum.has(HardwareCounter::Instructions) || sum[HardwareCounter::Cycles] == 0)
+        return 0;
+    return static_cast<double>(sum[HardwareCounter::Instructions]) / sum[HardwareCounter::Cycles];
+}
+
+#if defined(__linux__)
+
+// perf_event_attr type and config of each HardwareCounter
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} COUNTER_EVENTS[COUNTER_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+PerfCounters::PerfCounters() {
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        fds_[c] = -1;
+        slots_[c] = COUNTER_COUNT;
+
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = COUNTER_EVENTS[c].type;
+        attr.config = COUNTER_EVENTS[c].config;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1; // Allowed up to perf_event_paranoid 2
+        attr.exclude_hv = 1;
+
+        // The first counter that opens leads the group, the others are scheduled together with it
+        const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_, 0));
+        if (fd < 0) {
+            if (error_.empty())
+                error_ = std::string(counter_name(static_cast<HardwareCounter>(c))) + ": " + std::strerror(errno);
+            continue;
+        }
+        if (group_ < 0)
+            group_ = fd;
+        fds_[c] = fd;
+        slots_[c] = opened_++;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        if (fds_[c] >= 0)
+            close(fds_[c]);
+    }
+}
+
+bool PerfCounters::read_group(uint64_t values[COUNTER_COUNT], uint64_t &enabled, uint64_t &running) const {
+    // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, then one value per opened counter
+    uint64_t buffer[3 + COUNTER_COUNT];
+    const ssize_t expected = static_cast<ssize_t>((3 + opened_) * sizeof(uint64_t));
+    if (group_ < 0 || read(group_, buffer, sizeof(buffer)) != expected)
+        return false;
+    enabled = buffer[1];
+    running = buffer[2];
+    for (size_t c = 0; c < COUNTER_COUNT; c++)
+        values[c] = slots_[c] < opened_ ? buffer[3 + slots_[c]] : 0;
+    return true;
+}
+
+void PerfCounters::start() {
+    if (!read_group(start_values_, start_enabled_, start_running_))
+        start_enabled_ = start_running_ = 0;
+}
+
+CounterSample PerfCounters::stop() {
+    CounterSample sample;
+    uint64_t values[COUNTER_COUNT], enabled, running;
+    if (!read_group(values, enabled, running) || running <= start_running_)
+        return sample;
+
+    // Scale to the whole interval if the group was only on the PMU part of the time
+    const double scale = static_cast<double>(enabled - start_enabled_) / (running - start_running_);
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        if (slots_[c] == COUNTER_COUNT)
+            continue;
+        sample.values[c] = static_cast<uint64_t>((values[c] - start_values_[c]) * scale + 0.5);
+        sample.valid[c] = true;
+    }
+    return sample;
+}
+
+#else
+
+PerfCounters::PerfCounters() : error_("perf_event_open is Linux only") {
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        fds_[c] = -1;
+        slots_[c] = COUNTER_COUNT;
+    }
+}
+
+PerfCounters::~PerfCounters() {}
+
+bool PerfCounters::read_group(uint64_t *, uint64_t &, uint64_t &) const {
+    return false;
+}
+
+void PerfCounters::start() {}
+
+CounterSample PerfCounters::stop() {
+    return CounterSample();
+}
+
+#endif
+
+// Value per call or per unit of work, "-" when unavailable
+static void print_ratio(std::ostream &out, int width, const CounterTotals &totals, HardwareCounter counter, double divisor) {
+    if (!totals.sum.has(counter) || divisor <= 0) {
+        out << std::setw(width) << "-";
+        return;
+    }
+    out << std::setw(width) << totals.sum[counter] / divisor;
+}
+
+void print_counter_table(std::ostream &out, const std::vector<CounterRow> &rows, const char *work_unit) {
+    const std::string per_work = std::string("/") + work_unit;
+    const std::streamsize precision = out.precision();
+    out << std::left << std::setw(24) << "" << std::right << std::setw(8) << "calls" << std::setw(12) << "cycles"
+        << std::setw(14) << "instructions" << std::setw(7) << "IPC" << std::setw(16) << "L1D miss" + per_work
+        << std::setw(16) << "LLC miss" + per_work << std::setw(14) << "branch miss" << std::endl;
+
+    for (const CounterRow &row : rows) {
+        const CounterTotals &totals = row.totals;
+        const double calls = static_cast<double>(totals.calls);
+        const double work = calls * row.work;
+        out << std::left << std::setw(24) << row.name << std::right << std::setw(8) << totals.calls << std::fixed
+            << std::setprecision(0);
+        print_ratio(out, 12, totals, HardwareCounter::Cycles, calls);
+        print_ratio(out, 14, totals, HardwareCounter::Instructions, calls);
+        out << std::setprecision(2);
+        if (totals.ipc() > 0)
+            out << std::setw(7) << totals.ipc();
+        else
+            out << std::setw(7) << "-";
+        out << std::setprecision(4);
+        print_ratio(out, 16, totals, HardwareCounter::L1DMisses, work);
+        print_ratio(out, 16, totals, HardwareCounter::LLCMisses, work);
+        out << std::setprecision(1);
+        print_ratio(out, 14, totals, HardwareCounter::BranchMisses, calls);
+        out << std::endl;
+    }
+    out.unsetf(std::ios::fixed);
+    out.precision(precision);
+}
@@ -0,0 +1,107 @@
+#ifndef ENGINE_COUNTERS_H
+#define ENGINE_COUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Hardware events read through Linux perf_event_open, user space only
+enum class HardwareCounter : uint8_t {
+    Cycles = 0,
+    Instructions = 1,
+    L1DMisses = 2,  // L1 data cache read misses
+    LLCMisses = 3,  // Last level cache misses
+    BranchMisses = 4,
+};
+
+static const size_t COUNTER_COUNT = 5;
+
+const char *counter_name(HardwareCounter counter);
+
+// Counter deltas over some code, scaled up when the kernel multiplexed the counters. `valid` is false for counters
+// that could not be opened or did not run at all.
+struct CounterSample {
+    uint64_t values[COUNTER_COUNT] = {};
+    bool valid[COUNTER_COUNT] = {};
+
+    uint64_t operator[](HardwareCounter counter) const {
+        return values[static_cast<size_t>(counter)];
+    }
+
+    bool has(HardwareCounter counter) const {
+        return valid[static_cast<size_t>(counter)];
+    }
+};
+
+// Sum of the samples of one piece of code (a layer, CSV parsing), a counter staying valid only if it was in all of them
+struct CounterTotals {
+    CounterSample sum;
+    size_t samples = 0; // Number of add() calls
+    size_t calls = 0;   // Number of calls the samples covered
+
+    void add(const CounterSample &sample, size_t sample_calls = 1);
+
+    // Instructions per cycle, 0 without both counters
+    double ipc() const;
+};
+
+// The five counters of the calling thread, opened as one group so that they cover exactly the same instructions.
+// Never throws: when perf_event_open is missing, forbidden (perf_event_paranoid, containers) or the CPU has no such
+// event (most VMs), the affected counters are invalid in every sample, and available() is false if none opened.
+// Threads of a WorkerPool are not counted.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available() const {
+        return group_ >= 0;
+    }
+
+    // Why the first counter that failed could not be opened, empty if all opened
+    const std::string &error() const {
+        return error_;
+    }
+
+    void start();
+    CounterSample stop();
+
+    // Counts `calls` calls to fn() as one sample
+    template<typename F>
+    CounterSample count(F &&fn, size_t calls = 1) {
+        start();
+        for (size_t i = 0; i < calls; i++)
+            fn();
+        return stop();
+    }
+
+private:
+    // Reads the group: fills values (indexed like HardwareCounter), time enabled and time running
+    bool read_group(uint64_t values[COUNTER_COUNT], uint64_t &enabled, uint64_t &running) const;
+
+    int group_ = -1;
+    int fds_[COUNTER_COUNT];
+    size_t slots_[COUNTER_COUNT]; // Position of each counter in the group read, COUNTER_COUNT if not opened
+    size_t opened_ = 0;
+    std::string error_;
+    uint64_t start_values_[COUNTER_COUNT] = {};
+    uint64_t start_enabled_ = 0, start_running_ = 0;
+};
+
+// One line of a counter report; `work` is the MACs (or parsed values) of one call, 0 when misses per unit of work
+// make no sense (pooling, flatten)
+struct CounterRow {
+    std::string name;
+    CounterTotals totals;
+    size_t work;
+};
+
+// Per call cycles, instructions and branch misses, IPC, and L1D/LLC misses per unit of work; "-" where a counter is
+// unavailable
+void print_counter_table(std::ostream &out, const std::vector<CounterRow> &rows, const char *work_unit);
+
+#endif // ENGINE_COUNTERS_H
@@ -0,0 +1,131 @@
+#include "fixed.h"
+
+// Each kernel is a template over the formats of its input, weights and output, instantiated below with the Q format
+// of the generated model. Layers with other formats only need other instantiations.
+
+// N consecutive output positions of one filter. With Unit set the stride is known to be 1, which lets the pack loads
+// vectorize, and a nonzero Size unrolls the taps like conv1d_generic does for small kernels.
+template<size_t N, bool Unit, size_t Size, typename In, typename W, typename Out>
+static inline void conv1d_block(const typename In::storage_type *input, const typename W::storage_type *filter,
+                                Out bias, size_t in_channels, size_t in_samples, size_t size, size_t stride,
+                                Activation activation, typename Out::storage_type *output) {
+    if (Size)
+        size = Size;
+    FixedAccumulator<N, In, W> acc;
+    for (size_t z = 0; z < in_channels; z++) {
+        const typename In::storage_type *in = input + z * in_samples;
+        const typename W::storage_type *w = filter + z * size;
+        for (size_t x = 0; x < size; x++)
+            acc.mac(in + x, Unit ? 1 : stride, W::from_raw(w[x]));
+    }
+    acc.template requantize<Out>(bias, activation).store(output);
+}
+
+template<bool Unit, size_t Size, typename In, typename W, typename Out>
+static void conv1d_fixed_rows(const Layer &layer, const number_t *input, number_t *output) {
+    const size_t in_channels = layer.in_channels, in_samples = layer.in_samples;
+    const size_t filters = layer.out_channels, out_samples = layer.out_samples;
+    const size_t size = layer.size, stride = layer.stride;
+    const Activation activation = layer.activation;
+
+    for (size_t k = 0; k < filters; k++) {
+        const number_t *filter = layer.kernel + k * in_channels * size;
+        const Out bias = Out::from_raw(layer.bias[k]);
+        number_t *out = output + k * out_samples;
+        size_t pos_x = 0;
+        for (; pos_x + FIXED_LANES <= out_samples; pos_x += FIXED_LANES)
+            conv1d_block<FIXED_LANES, Unit, Size, In, W, Out>(input + pos_x * stride, filter, bias, in_channels, in_samples,
+                                                        size, stride, activation, out + pos_x);
+        for (; pos_x < out_samples; pos_x++)
+            conv1d_block<1, Unit, Size, In, W, Out>(input + pos_x * stride, filter, bias, in_channels, in_samples, size,
+                                              stride, activation, out + pos_x);
+    }
+}
+
+void conv1d_fixed(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    if (layer.stride == 1 && layer.size == 3)
+        conv1d_fixed_rows<true, 3, Q, Q, Q>(layer, input, output);
+    else if (layer.stride == 1)
+        conv1d_fixed_rows<true, 0, Q, Q, Q>(layer, input, output);
+    else
+        conv1d_fixed_rows<false, 0, Q, Q, Q>(layer, input, output);
+}
+
+template<size_t N, typename T>
+static inline void max_pool1d_block(const typename T::storage_type *window, size_t size, size_t stride, bool relu,
+                                    typename T::storage_type *output) {
+    // Linear pooling starts from the first element, ReLU pooling from 0 like the generated code
+    FixedPack<N, T> pooled = relu ? FixedPack<N, T>::broadcast(T::from_raw(0)) : FixedPack<N, T>::load(window, stride);
+    for (size_t x = 0; x < size; x++)
+        pooled = max(pooled, FixedPack<N, T>::load(window + x, stride));
+    pooled.store(output);
+}
+
+template<typename T>
+static void max_pool1d_fixed_rows(const Layer &layer, const number_t *input, number_t *output) {
+    const size_t channels = layer.in_channels, in_samples = layer.in_samples, out_samples = layer.out_samples;
+    const size_t size = layer.size, stride = layer.stride;
+    const bool relu = layer.activation == Activation::ReLU;
+
+    for (size_t k = 0; k < channels; k++) {
+        const number_t *in = input + k * in_samples;
+        number_t *out = output + k * out_samples;
+        size_t pos_x = 0;
+        for (; pos_x + FIXED_LANES <= out_samples; pos_x += FIXED_LANES)
+            max_pool1d_block<FIXED_LANES, T>(in + pos_x * stride, size, stride, relu, out + pos_x);
+        for (; pos_x < out_samples; pos_x++)
+            max_pool1d_block<1, T>(in + pos_x * stride, size, stride, relu, out + pos_x);
+    }
+}
+
+void max_pool1d_fixed(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    max_pool1d_fixed_rows<Q>(layer, input, output);
+}
+
+template<typename In, typename Out>
+static void avg_pool1d_fixed_rows(const Layer &layer, const number_t *input, number_t *output) {
+    const size_t channels = layer.in_channels, in_samples = layer.in_samples, out_samples = layer.out_samples;
+    const size_t size = layer.size, stride = layer.stride;
+    const bool relu = layer.activation == Activation::ReLU;
+
+    for (size_t k = 0; k < channels; k++) {
+        const number_t *in = input + k * in_samples;
+        number_t *out = output + k * out_samples;
+        for (size_t pos_x = 0; pos_x < out_samples; pos_x++) {
+            typename In::wide_type sum = 0;
+            for (size_t x = 0; x < size; x++)
+                sum += In::from_raw(in[pos_x * stride + x]).wide();
+            if (relu)
+                sum = std::max<typename In::wide_type>(sum, 0);
+            // Truncating division, as in the generated average_pooling1d
+            out[pos_x] = Out::template from_wide<In::frac_bits>(sum / static_cast<typename In::wide_type>(size)).raw;
+        }
+    }
+}
+
+void avg_pool1d_fixed(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    avg_pool1d_fixed_rows<Q, Q>(layer, input, output);
+}
+
+template<typename In, typename W, typename Out>
+static void dense_fixed_rows(const Layer &layer, const number_t *input, number_t *output) {
+    const size_t inputs = input_size(layer), units = layer.out_channels;
+    const Activation activation = layer.activation;
+
+    for (size_t k = 0; k < units; k++) {
+        const number_t *weights = layer.kernel + k * inputs;
+        FixedAccumulator<FIXED_LANES, In, W> acc;
+        FixedAccumulator<1, In, W> total;
+        size_t z = 0;
+        for (; z + FIXED_LANES <= inputs; z += FIXED_LANES)
+            acc.mac(FixedPack<FIXED_LANES, In>::load(input + z), FixedPack<FIXED_LANES, W>::load(weights + z));
+        for (; z < inputs; z++)
+            total.mac(FixedPack<1, In>::load(input + z), W::from_raw(weights[z]));
+        total.acc[0] += acc.sum();
+        output[k] = total.template requantize<Out>(Out::from_raw(layer.bias[k]), activation).raw[0];
+    }
+}
+
+void dense_fixed(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    dense_fixed_rows<Q, Q, Q>(layer, input, output);
+}
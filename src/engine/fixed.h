@@ -0,0 +1,208 @@
+#ifndef ENGINE_FIXED_H
+#define ENGINE_FIXED_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "layer.h"
+
+// Integer type holding the product of two values of a storage type and sums of many such products
+template<typename Storage> struct FixedWide;
+template<> struct FixedWide<int8_t> { typedef int32_t type; };
+template<> struct FixedWide<int16_t> { typedef int32_t type; };
+template<> struct FixedWide<int32_t> { typedef int64_t type; };
+
+// Converts a raw value with `From` fractional bits to `To` fractional bits. Narrowing is an arithmetic right shift,
+// i.e. rounds toward negative infinity like scale_number_t().
+template<int From, int To, typename T>
+inline T rescale(T value) {
+    return From >= To ? value >> (From >= To ? From - To : 0) : value * (T(1) << (To >= From ? To - From : 0));
+}
+
+// Saturates a wide value to the range of Storage, branch-free so that loops over it vectorize
+template<typename Storage, typename T>
+inline Storage saturate(T value) {
+    return static_cast<Storage>(std::min<T>(std::max<T>(value, std::numeric_limits<Storage>::min()),
+                                            std::numeric_limits<Storage>::max()));
+}
+
+// Fixed-point number with FracBits fractional bits stored in Storage. Every operation saturates to the storage range;
+// Fixed<number_t, FIXED_POINT> reproduces the arithmetic of number.h (scale_number_t() then clamp_to_number_t()).
+template<typename Storage, int FracBits>
+struct Fixed {
+    typedef Storage storage_type;
+    typedef typename FixedWide<Storage>::type wide_type;
+    static const int frac_bits = FracBits;
+
+    Storage raw;
+
+    static Fixed from_raw(Storage raw) {
+        Fixed value;
+        value.raw = raw;
+        return value;
+    }
+
+    // Saturates a wide value already in this format
+    static Fixed saturate(wide_type value) {
+        return from_raw(::saturate<Storage>(value));
+    }
+
+    // Requantizes a wide value with `From` fractional bits, e.g. an accumulator of products
+    template<int From, typename T>
+    static Fixed from_wide(T value) {
+        return from_raw(::saturate<Storage>(rescale<From, FracBits>(value)));
+    }
+
+    template<typename To>
+    To requantize() const {
+        return To::template from_wide<FracBits>(static_cast<typename To::wide_type>(raw));
+    }
+
+    wide_type wide() const {
+        return raw;
+    }
+
+    friend Fixed operator+(Fixed a, Fixed b) {
+        return saturate(a.wide() + b.wide());
+    }
+
+    friend Fixed operator-(Fixed a, Fixed b) {
+        return saturate(a.wide() - b.wide());
+    }
+
+    friend Fixed operator*(Fixed a, Fixed b) {
+        return from_wide<2 * FracBits>(a.wide() * b.wide());
+    }
+
+    friend bool operator<(Fixed a, Fixed b) {
+        return a.raw < b.raw;
+    }
+
+    friend bool operator==(Fixed a, Fixed b) {
+        return a.raw == b.raw;
+    }
+};
+
+// The format of the generated model
+typedef Fixed<number_t, FIXED_POINT> Q;
+
+// Keeps a loop over the lanes from being fully unrolled before the loop vectorizer sees it: GCC vectorizes the
+// widening multiply-accumulates of an 8-lane loop (pmullw/pmulhw) but leaves them scalar once unrolled.
+#define FIXED_LANE_LOOP _Pragma("GCC unroll 1")
+
+// N fixed-point values processed together. Operations are plain loops over the lanes without branches, which GCC and
+// Clang turn into saturating vector code (packssdw, pmaxsw, ...) at -O2 and above.
+template<size_t N, typename T = Q>
+struct FixedPack {
+    typedef typename T::storage_type storage_type;
+    typedef typename T::wide_type wide_type;
+    static const size_t lanes = N;
+
+    storage_type raw[N];
+
+    static FixedPack load(const storage_type *values, size_t stride = 1) {
+        FixedPack pack;
+        for (size_t i = 0; i < N; i++)
+            pack.raw[i] = values[i * stride];
+        return pack;
+    }
+
+    static FixedPack broadcast(T value) {
+        FixedPack pack;
+        for (size_t i = 0; i < N; i++)
+            pack.raw[i] = value.raw;
+        return pack;
+    }
+
+    void store(storage_type *values) const {
+        for (size_t i = 0; i < N; i++)
+            values[i] = raw[i];
+    }
+
+    friend FixedPack operator+(const FixedPack &a, const FixedPack &b) {
+        FixedPack pack;
+        for (size_t i = 0; i < N; i++)
+            pack.raw[i] = ::saturate<storage_type>(static_cast<wide_type>(a.raw[i]) + b.raw[i]);
+        return pack;
+    }
+
+    friend FixedPack operator*(const FixedPack &a, const FixedPack &b) {
+        FixedPack pack;
+        for (size_t i = 0; i < N; i++)
+            pack.raw[i] = ::saturate<storage_type>(
+                rescale<2 * T::frac_bits, T::frac_bits>(static_cast<wide_type>(a.raw[i]) * b.raw[i]));
+        return pack;
+    }
+
+    friend FixedPack max(const FixedPack &a, const FixedPack &b) {
+        FixedPack pack;
+        for (size_t i = 0; i < N; i++)
+            pack.raw[i] = std::max(a.raw[i], b.raw[i]);
+        return pack;
+    }
+};
+
+// N wide accumulators of products of In and W values, holding In::frac_bits + W::frac_bits fractional bits
+template<size_t N, typename In, typename W>
+struct FixedAccumulator {
+    typedef typename W::wide_type wide_type;
+    static const int frac_bits = In::frac_bits + W::frac_bits;
+
+    wide_type acc[N];
+
+    FixedAccumulator() {
+        std::fill(acc, acc + N, 0);
+    }
+
+    // acc[i] += in[i] * w
+    void mac(const FixedPack<N, In> &in, W w) {
+        FIXED_LANE_LOOP
+        for (size_t i = 0; i < N; i++)
+            acc[i] += static_cast<wide_type>(in.raw[i]) * w.raw;
+    }
+
+    // acc[i] += in[i * stride] * w, reading the inputs straight from memory
+    void mac(const typename In::storage_type *in, size_t stride, W w) {
+        FIXED_LANE_LOOP
+        for (size_t i = 0; i < N; i++)
+            acc[i] += static_cast<wide_type>(in[i * stride]) * w.raw;
+    }
+
+    // acc[i] += in[i] * w[i]
+    void mac(const FixedPack<N, In> &in, const FixedPack<N, W> &w) {
+        FIXED_LANE_LOOP
+        for (size_t i = 0; i < N; i++)
+            acc[i] += static_cast<wide_type>(in.raw[i]) * w.raw[i];
+    }
+
+    wide_type sum() const {
+        wide_type total = 0;
+        for (size_t i = 0; i < N; i++)
+            total += acc[i];
+        return total;
+    }
+
+    // Rescales to Out, adds the bias and applies the activation, in the order of the generated code
+    template<typename Out>
+    FixedPack<N, Out> requantize(Out bias, Activation activation) const {
+        const wide_type floor = activation == Activation::ReLU ? 0 : std::numeric_limits<wide_type>::min();
+        FixedPack<N, Out> pack;
+        for (size_t i = 0; i < N; i++)
+            pack.raw[i] = ::saturate<typename Out::storage_type>(
+                std::max(rescale<frac_bits, Out::frac_bits>(acc[i]) + bias.raw, floor));
+        return pack;
+    }
+};
+
+// Lanes of the FixedPack kernels: 8 int16 values fill one SSE2/NEON register
+static const size_t FIXED_LANES = 8;
+
+// Kernels written with Fixed and FixedPack in the Q format, bit-identical with the generic ones
+void conv1d_fixed(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void max_pool1d_fixed(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void avg_pool1d_fixed(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void dense_fixed(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+
+#endif // ENGINE_FIXED_H
@@ -0,0 +1,131 @@
+#include "gemm.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "kernels.h"
+
+// Depth of the product, rounded up to whole pairs: the micro-kernel multiplies pairs of int16 and sums each pair in
+// int32 (pmaddwd)
+static size_t depth(const Layer &layer) {
+    return (static_cast<size_t>(layer.in_channels) * layer.size + 1) / 2 * 2;
+}
+
+// Columns of one im2col tile: as many as fit in GEMM_TILE_BYTES, a multiple of GEMM_NR
+static size_t tile_columns(const Layer &layer) {
+    const size_t columns = GEMM_TILE_BYTES / (depth(layer) * sizeof(number_t)) / GEMM_NR * GEMM_NR;
+    return std::max(GEMM_NR, columns);
+}
+
+// Scratch: one im2col tile, whatever the batch size
+size_t conv1d_gemm_scratch(const Layer &layer) {
+    return depth(layer) * tile_columns(layer) * sizeof(number_t);
+}
+
+std::shared_ptr<void> conv1d_gemm_prepare(const Layer &layer) {
+    auto state = std::make_shared<GemmConvState>();
+    const size_t filters = layer.out_channels, values = static_cast<size_t>(layer.in_channels) * layer.size, rows = depth(layer);
+    const size_t blocks = (filters + GEMM_MR - 1) / GEMM_MR;
+    state->weights.assign(blocks * rows * GEMM_MR, 0);
+    for (size_t k = 0; k < filters; k++)
+        for (size_t d = 0; d < values; d++)
+            state->weights[((k / GEMM_MR * rows / 2 + d / 2) * GEMM_MR + k % GEMM_MR) * 2 + d % 2] = layer.kernel[k * values + d];
+    return state;
+}
+
+// Sums of GEMM_MR filters times GEMM_NR columns over the whole depth. `weights` holds, for every pair of depth
+// values, the pair of each filter; `tile` the pair of each column, rows of `width` columns.
+static void micro_kernel(const number_t *weights, const number_t *tile, size_t pairs, size_t width, long_number_t sums[GEMM_MR][GEMM_NR]) {
+#if defined(__SSE2__)
+    static_assert(GEMM_MR == 4 && GEMM_NR == 8, "the SSE2 micro-kernel holds 4 x 8 sums");
+    __m128i acc[GEMM_MR][2];
+    for (size_t m = 0; m < GEMM_MR; m++)
+        acc[m][0] = acc[m][1] = _mm_setzero_si128();
+    for (size_t p = 0; p < pairs; p++) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tile + p * width * 2));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tile + p * width * 2 + 8));
+        const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + p * GEMM_MR * 2));
+        const __m128i w0 = _mm_shuffle_epi32(w, _MM_SHUFFLE(0, 0, 0, 0)), w1 = _mm_shuffle_epi32(w, _MM_SHUFFLE(1, 1, 1, 1));
+        const __m128i w2 = _mm_shuffle_epi32(w, _MM_SHUFFLE(2, 2, 2, 2)), w3 = _mm_shuffle_epi32(w, _MM_SHUFFLE(3, 3, 3, 3));
+        acc[0][0] = _mm_add_epi32(acc[0][0], _mm_madd_epi16(w0, low));
+        acc[0][1] = _mm_add_epi32(acc[0][1], _mm_madd_epi16(w0, high));
+        acc[1][0] = _mm_add_epi32(acc[1][0], _mm_madd_epi16(w1, low));
+        acc[1][1] = _mm_add_epi32(acc[1][1], _mm_madd_epi16(w1, high));
+        acc[2][0] = _mm_add_epi32(acc[2][0], _mm_madd_epi16(w2, low));
+        acc[2][1] = _mm_add_epi32(acc[2][1], _mm_madd_epi16(w2, high));
+        acc[3][0] = _mm_add_epi32(acc[3][0], _mm_madd_epi16(w3, low));
+        acc[3][1] = _mm_add_epi32(acc[3][1], _mm_madd_epi16(w3, high));
+    }
+    for (size_t m = 0; m < GEMM_MR; m++) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(sums[m]), acc[m][0]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(sums[m] + 4), acc[m][1]);
+    }
+#else
+    for (size_t m = 0; m < GEMM_MR; m++)
+        for (size_t n = 0; n < GEMM_NR; n++)
+            sums[m][n] = 0;
+    for (size_t p = 0; p < pairs; p++) {
+        const number_t *values = tile + p * width * 2, *a = weights + p * GEMM_MR * 2;
+        for (size_t m = 0; m < GEMM_MR; m++)
+            for (size_t n = 0; n < GEMM_NR; n++)
+                sums[m][n] += a[2 * m] * values[2 * n] + a[2 * m + 1] * values[2 * n + 1];
+    }
+#endif
+}
+
+void conv1d_gemm(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state) {
+    conv1d_gemm_batch(layer, input, output, 1, scratch, state);
+}
+
+void conv1d_gemm_batch(const Layer &layer, const number_t *input, number_t *output, size_t count, void *scratch, void *state) {
+    const GemmConvState &gemm = *static_cast<const GemmConvState *>(state);
+    const size_t in_channels = layer.in_channels, in_samples = layer.in_samples, size = layer.size, stride = layer.stride;
+    const size_t filters = layer.out_channels, out_samples = layer.out_samples;
+    const size_t values = in_channels * size, pairs = depth(layer) / 2, columns = count * out_samples, width = tile_columns(layer);
+    const Activation activation = layer.activation;
+    number_t *tile = static_cast<number_t *>(scratch);
+
+    for (size_t t0 = 0; t0 < columns; t0 += width) {
+        // im2col of the tile: for every pair of depth values, the pair of each column side by side, a column being
+        // the receptive field of one output position of one input of the batch. The tile runs across the boundaries
+        // between inputs, and is zero-padded past the depth and past the last column to a whole GEMM_NR block.
+        const size_t tile_width = std::min(width, columns - t0), padded = (tile_width + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+        for (size_t n = 0; n < tile_width;) {
+            const size_t b = (t0 + n) / out_samples, pos_x = (t0 + n) % out_samples;
+            const size_t run = std::min(tile_width - n, out_samples - pos_x); // Columns of input b in this tile
+            for (size_t z = 0; z < in_channels; z++) {
+                const number_t *channel = input + (b * in_channels + z) * in_samples + pos_x * stride;
+                for (size_t j = 0; j < size; j++) {
+                    const size_t d = z * size + j;
+                    number_t *row = tile + (d / 2 * width + n) * 2 + d % 2;
+                    for (size_t c = 0; c < run; c++)
+                        row[2 * c] = channel[c * stride + j];
+                }
+            }
+            n += run;
+        }
+        if (values % 2)
+            for (size_t n = 0; n < tile_width; n++)
+                tile[((pairs - 1) * width + n) * 2 + 1] = 0;
+        for (size_t p = 0; p < pairs; p++)
+            std::fill(tile + (p * width + tile_width) * 2, tile + (p * width + padded) * 2, 0);
+
+        // Every block of GEMM_MR filters sweeps the tile, which stays in L1 with the packed weights
+        for (size_t k0 = 0; k0 < filters; k0 += GEMM_MR) {
+            const number_t *weights = gemm.weights.data() + k0 / GEMM_MR * pairs * GEMM_MR * 2;
+            for (size_t n0 = 0; n0 < padded; n0 += GEMM_NR) {
+                long_number_t sums[GEMM_MR][GEMM_NR];
+                micro_kernel(weights, tile + n0 * 2, pairs, width, sums);
+                for (size_t n = 0; n < GEMM_NR && n0 + n < tile_width; n++) {
+                    const size_t column = t0 + n0 + n, b = column / out_samples, pos_x = column % out_samples;
+                    for (size_t m = 0; m < GEMM_MR && k0 + m < filters; m++)
+                        output[(b * filters + k0 + m) * out_samples + pos_x] =
+                            activate(activation, scale_number_t(sums[m][n]) + layer.bias[k0 + m]);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef ENGINE_GEMM_H
+#define ENGINE_GEMM_H
+
+#include <memory>
+#include <vector>
+
+#include "layer.h"
+
+// Filters and output positions whose sums the GEMM micro-kernel holds in registers, and bytes of the im2col tile it
+// sweeps, sized to stay in L1 next to the weights
+static const size_t GEMM_MR = 4;
+static const size_t GEMM_NR = 8;
+static const size_t GEMM_TILE_BYTES = 16384;
+
+// Conv1D as a matrix product: im2col unrolls the receptive field of every output position into a column of
+// in_channels * size values, the filters are the rows of the other operand, and a register-blocked micro-kernel
+// multiplies them with int16 x int16 products summed in int32. The columns are built and consumed a tile at a time,
+// the tiles of a batch running across the boundaries between inputs, so a batch adds columns without growing the
+// scratch. Integer sums are exact, so the order of the products does not change the result.
+struct GemmConvState {
+    std::vector<number_t> weights; // [filters / GEMM_MR][depth / 2][GEMM_MR][2], zero-padded
+};
+
+size_t conv1d_gemm_scratch(const Layer &layer);
+std::shared_ptr<void> conv1d_gemm_prepare(const Layer &layer);
+void conv1d_gemm(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void conv1d_gemm_batch(const Layer &layer, const number_t *input, number_t *output, size_t count, void *scratch, void *state);
+
+#endif // ENGINE_GEMM_H
@@ -0,0 +1,121 @@
+// Compiles the generated model (layer functions, weight tables and cnn()) into the engine, so tools built on the engine
+// link this file instead of gsc_output/model.c
+#include "model.c"
+
+#include <type_traits>
+
+#include "graph.h"
+
+template<typename T, unsigned N>
+static constexpr uint16_t dim() {
+    return static_cast<uint16_t>(std::extent<T, N>::value);
+}
+
+template<typename Output>
+static Layer pool_layer(LayerType type, const char *name, const Layer &previous, uint16_t size) {
+    Layer layer = {type, Activation::Linear, previous.out_channels, previous.out_samples, dim<Output, 0>(), dim<Output, 1>(),
+                   size, size, nullptr, nullptr, name};
+    return layer;
+}
+
+template<typename Output, typename Kernel>
+static Layer conv_layer(const char *name, const Layer &previous, const Kernel &kernel, const number_t *bias) {
+    Layer layer = {LayerType::Conv1D, Activation::ReLU, previous.out_channels, previous.out_samples, dim<Output, 0>(),
+                   dim<Output, 1>(), dim<Kernel, 2>(), 1, &kernel[0][0][0], bias, name};
+    return layer;
+}
+
+// Flat buffers seen as the multidimensional arrays the generated functions take
+template<typename Array>
+static const typename std::remove_extent<Array>::type *in(const number_t *data) {
+    return reinterpret_cast<const typename std::remove_extent<Array>::type *>(data);
+}
+
+template<typename Array>
+static typename std::remove_extent<Array>::type *out(number_t *data) {
+    return reinterpret_cast<typename std::remove_extent<Array>::type *>(data);
+}
+
+typedef number_t model_input_type[MODEL_INPUT_CHANNELS][MODEL_INPUT_SAMPLES];
+
+static void run_max_pooling1d(const number_t *input, number_t *output) {
+    max_pooling1d(in<model_input_type>(input), out<max_pooling1d_output_type>(output));
+}
+
+static void run_conv1d(const number_t *input, number_t *output) {
+    conv1d(in<max_pooling1d_output_type>(input), conv1d_kernel, conv1d_bias, out<conv1d_output_type>(output));
+}
+
+static void run_max_pooling1d_1(const number_t *input, number_t *output) {
+    max_pooling1d_1(in<conv1d_output_type>(input), out<max_pooling1d_1_output_type>(output));
+}
+
+static void run_conv1d_1(const number_t *input, number_t *output) {
+    conv1d_1(in<max_pooling1d_1_output_type>(input), conv1d_1_kernel, conv1d_1_bias, out<conv1d_1_output_type>(output));
+}
+
+static void run_max_pooling1d_2(const number_t *input, number_t *output) {
+    max_pooling1d_2(in<conv1d_1_output_type>(input), out<max_pooling1d_2_output_type>(output));
+}
+
+static void run_conv1d_2(const number_t *input, number_t *output) {
+    conv1d_2(in<max_pooling1d_2_output_type>(input), conv1d_2_kernel, conv1d_2_bias, out<conv1d_2_output_type>(output));
+}
+
+static void run_max_pooling1d_3(const number_t *input, number_t *output) {
+    max_pooling1d_3(in<conv1d_2_output_type>(input), out<max_pooling1d_3_output_type>(output));
+}
+
+static void run_average_pooling1d(const number_t *input, number_t *output) {
+    average_pooling1d(in<max_pooling1d_3_output_type>(input), out<average_pooling1d_output_type>(output));
+}
+
+static void run_dense(const number_t *input, number_t *output) {
+    dense(input, dense_kernel, dense_bias, output);
+}
+
+const std::vector<GeneratedLayer> &generated_layers() {
+    static const std::vector<GeneratedLayer> layers = {
+        {"max_pooling1d", run_max_pooling1d},
+        {"conv1d", run_conv1d},
+        {"max_pooling1d_1", run_max_pooling1d_1},
+        {"conv1d_1", run_conv1d_1},
+        {"max_pooling1d_2", run_max_pooling1d_2},
+        {"conv1d_2", run_conv1d_2},
+        {"max_pooling1d_3", run_max_pooling1d_3},
+        {"average_pooling1d", run_average_pooling1d},
+        {"dense", run_dense},
+    };
+    return layers;
+}
+
+Graph generated_graph() {
+    Graph graph;
+    graph.input_channels = MODEL_INPUT_CHANNELS;
+    graph.input_samples = MODEL_INPUT_SAMPLES;
+
+    // Pool sizes are the POOL_SIZE of each generated layer file, whose macros are undefined once the layer is declared
+    Layer input = {};
+    input.out_channels = MODEL_INPUT_CHANNELS;
+    input.out_samples = MODEL_INPUT_SAMPLES;
+    auto &layers = graph.layers;
+    layers.push_back(pool_layer<max_pooling1d_output_type>(LayerType::MaxPool1D, "max_pooling1d", input, 20));
+    layers.push_back(conv_layer<conv1d_output_type>("conv1d", layers.back(), conv1d_kernel, conv1d_bias));
+    layers.push_back(pool_layer<max_pooling1d_1_output_type>(LayerType::MaxPool1D, "max_pooling1d_1", layers.back(), 4));
+    layers.push_back(conv_layer<conv1d_1_output_type>("conv1d_1", layers.back(), conv1d_1_kernel, conv1d_1_bias));
+    layers.push_back(pool_layer<max_pooling1d_2_output_type>(LayerType::MaxPool1D, "max_pooling1d_2", layers.back(), 4));
+    layers.push_back(conv_layer<conv1d_2_output_type>("conv1d_2", layers.back(), conv1d_2_kernel, conv1d_2_bias));
+    layers.push_back(pool_layer<max_pooling1d_3_output_type>(LayerType::MaxPool1D, "max_pooling1d_3", layers.back(), 4));
+    layers.push_back(pool_layer<average_pooling1d_output_type>(LayerType::AvgPool1D, "average_pooling1d", layers.back(), 8));
+
+    Layer flatten_layer = {LayerType::Flatten, Activation::Linear, layers.back().out_channels, layers.back().out_samples,
+                           static_cast<uint16_t>(std::extent<flatten_output_type, 0>::value), 1, 0, 0, nullptr, nullptr, "flatten"};
+    layers.push_back(flatten_layer);
+
+    Layer dense_layer = {LayerType::Dense, Activation::Linear, layers.back().out_channels, 1, dim<dense_output_type, 0>(), 1,
+                         0, 0, &dense_kernel[0][0], dense_bias, "dense"};
+    layers.push_back(dense_layer);
+
+    graph.validate();
+    return graph;
+}
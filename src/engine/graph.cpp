@@ -0,0 +1,235 @@
+#include "graph.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+static const char GRAPH_MAGIC[4] = {'G', 'S', 'C', 'G'};
+static const uint16_t GRAPH_VERSION = 1;
+
+const char *layer_type_name(LayerType type) {
+    switch (type) {
+        case LayerType::Conv1D:
+            return "Conv1D";
+        case LayerType::MaxPool1D:
+            return "MaxPool1D";
+        case LayerType::AvgPool1D:
+            return "AvgPool1D";
+        case LayerType::Flatten:
+            return "Flatten";
+        case LayerType::Dense:
+            return "Dense";
+    }
+    return "?";
+}
+
+size_t Graph::macs() const {
+    size_t total = 0;
+    for (const auto &layer : layers)
+        total += ::macs(layer);
+    return total;
+}
+
+static void fnv1a(uint64_t &hash, const void *data, size_t bytes) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < bytes; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+}
+
+uint64_t Graph::hash() const {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint16_t header[] = {FIXED_POINT, input_channels, input_samples, static_cast<uint16_t>(layers.size())};
+    fnv1a(hash, header, sizeof(header));
+    for (const auto &layer : layers) {
+        const uint16_t fields[] = {static_cast<uint16_t>(layer.type), static_cast<uint16_t>(layer.activation),
+                                   layer.out_channels, layer.size, layer.stride};
+        fnv1a(hash, fields, sizeof(fields));
+        if (layer.kernel)
+            fnv1a(hash, layer.kernel, kernel_size(layer) * sizeof(number_t));
+        if (layer.bias)
+            fnv1a(hash, layer.bias, bias_size(layer) * sizeof(number_t));
+    }
+    return hash;
+}
+
+std::vector<uint64_t> Graph::prefix_hashes() const {
+    std::vector<uint64_t> hashes;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint16_t header[] = {FIXED_POINT, input_channels, input_samples};
+    fnv1a(hash, header, sizeof(header));
+    for (const auto &layer : layers) {
+        const uint16_t fields[] = {static_cast<uint16_t>(layer.type), static_cast<uint16_t>(layer.activation),
+                                   layer.out_channels, layer.size, layer.stride};
+        fnv1a(hash, fields, sizeof(fields));
+        if (layer.kernel)
+            fnv1a(hash, layer.kernel, kernel_size(layer) * sizeof(number_t));
+        if (layer.bias)
+            fnv1a(hash, layer.bias, bias_size(layer) * sizeof(number_t));
+        hashes.push_back(hash);
+    }
+    return hashes;
+}
+
+Graph Graph::owned_copy() const {
+    Graph copy = *this;
+    size_t values = 0;
+    for (const auto &layer : layers)
+        values += kernel_size(layer) + bias_size(layer);
+
+    copy.storage = std::make_shared<std::vector<number_t>>(values);
+    number_t *data = copy.storage->data();
+    for (auto &layer : copy.layers) {
+        if (kernel_size(layer) > 0) {
+            std::copy(layer.kernel, layer.kernel + kernel_size(layer), data);
+            layer.kernel = data;
+            data += kernel_size(layer);
+        }
+        if (bias_size(layer) > 0) {
+            std::copy(layer.bias, layer.bias + bias_size(layer), data);
+            layer.bias = data;
+            data += bias_size(layer);
+        }
+    }
+    return copy;
+}
+
+// Only meaningful for graphs owning their weights (owned_copy() or load()), whose storage is not const
+number_t *Graph::mutable_kernel(size_t layer) {
+    return const_cast<number_t *>(layers.at(layer).kernel);
+}
+
+number_t *Graph::mutable_bias(size_t layer) {
+    return const_cast<number_t *>(layers.at(layer).bias);
+}
+
+void Graph::validate() const {
+    uint16_t channels = input_channels, samples = input_samples;
+    for (size_t i = 0; i < layers.size(); i++) {
+        const Layer &layer = layers[i];
+        const std::string where = "layer " + std::to_string(i) + " (" + layer_type_name(layer.type) + ")";
+        if (layer.in_channels != channels || layer.in_samples != samples)
+            throw std::runtime_error(where + ": input shape does not match the previous layer output");
+        if ((layer.type == LayerType::Conv1D || layer.type == LayerType::MaxPool1D || layer.type == LayerType::AvgPool1D) &&
+            (layer.size == 0 || layer.stride == 0 || layer.size > layer.in_samples))
+            throw std::runtime_error(where + ": invalid window");
+        if ((layer.type == LayerType::Conv1D || layer.type == LayerType::Dense) && (!layer.kernel || !layer.bias))
+            throw std::runtime_error(where + ": missing weights");
+        // Shapes are 16-bit: a wrapped Flatten size would still match a Dense layer built for the wrapped value
+        if (layer.type == LayerType::Flatten && static_cast<size_t>(layer.in_channels) * layer.in_samples > UINT16_MAX)
+            throw std::runtime_error(where + ": " + std::to_string(static_cast<size_t>(layer.in_channels) * layer.in_samples) +
+                                     " values, more than a layer shape holds");
+        Layer expected = layer;
+        infer_output_shape(expected);
+        if (expected.out_channels != layer.out_channels || expected.out_samples != layer.out_samples)
+            throw std::runtime_error(where + ": output shape does not match the layer parameters");
+        channels = layer.out_channels;
+        samples = layer.out_samples;
+    }
+}
+
+template<typename T>
+static void write_value(std::ofstream &out, T value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+static T read_value(std::ifstream &in) {
+    T value;
+    if (!in.read(reinterpret_cast<char *>(&value), sizeof(value)))
+        throw std::runtime_error("truncated graph file");
+    return value;
+}
+
+void Graph::save(const char *filename) const {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out)
+        throw std::runtime_error(std::string("cannot write \"") + filename + "\": " + strerror(errno));
+
+    out.write(GRAPH_MAGIC, sizeof(GRAPH_MAGIC));
+    write_value<uint16_t>(out, GRAPH_VERSION);
+    write_value<uint8_t>(out, FIXED_POINT);
+    write_value<uint8_t>(out, 0);
+    write_value<uint16_t>(out, input_channels);
+    write_value<uint16_t>(out, input_samples);
+    write_value<uint16_t>(out, layers.size());
+    for (const auto &layer : layers) {
+        write_value<uint8_t>(out, static_cast<uint8_t>(layer.type));
+        write_value<uint8_t>(out, static_cast<uint8_t>(layer.activation));
+        write_value<uint16_t>(out, layer.out_channels);
+        write_value<uint16_t>(out, layer.size);
+        write_value<uint16_t>(out, layer.stride);
+    }
+    for (const auto &layer : layers) {
+        out.write(reinterpret_cast<const char *>(layer.kernel), kernel_size(layer) * sizeof(number_t));
+        out.write(reinterpret_cast<const char *>(layer.bias), bias_size(layer) * sizeof(number_t));
+    }
+    if (!out)
+        throw std::runtime_error(std::string("error writing \"") + filename + "\"");
+}
+
+Graph Graph::load(const char *filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        throw std::runtime_error(std::string("cannot open \"") + filename + "\": " + strerror(errno));
+
+    char magic[sizeof(GRAPH_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, GRAPH_MAGIC, sizeof(magic)) != 0)
+        throw std::runtime_error(std::string("\"") + filename + "\" is not a graph file");
+    if (read_value<uint16_t>(in) != GRAPH_VERSION)
+        throw std::runtime_error("unsupported graph version");
+    if (read_value<uint8_t>(in) != FIXED_POINT)
+        throw std::runtime_error("graph fixed point format differs from this build's FIXED_POINT");
+    read_value<uint8_t>(in);
+
+    Graph graph;
+    graph.input_channels = read_value<uint16_t>(in);
+    graph.input_samples = read_value<uint16_t>(in);
+    graph.layers.resize(read_value<uint16_t>(in));
+
+    // Read the layer headers and propagate shapes to size the weight storage
+    uint16_t channels = graph.input_channels, samples = graph.input_samples;
+    size_t values = 0;
+    for (auto &layer : graph.layers) {
+        layer = Layer();
+        layer.type = static_cast<LayerType>(read_value<uint8_t>(in));
+        layer.activation = static_cast<Activation>(read_value<uint8_t>(in));
+        layer.out_channels = read_value<uint16_t>(in);
+        layer.size = read_value<uint16_t>(in);
+        layer.stride = read_value<uint16_t>(in);
+        layer.in_channels = channels;
+        layer.in_samples = samples;
+        if (layer.type > LayerType::Dense || layer.activation > Activation::ReLU)
+            throw std::runtime_error("unknown layer type or activation in graph file");
+        if ((layer.type == LayerType::Conv1D || layer.type == LayerType::MaxPool1D || layer.type == LayerType::AvgPool1D) &&
+            (layer.size == 0 || layer.stride == 0 || layer.size > layer.in_samples))
+            throw std::runtime_error("invalid window in graph file");
+        infer_output_shape(layer);
+        layer.name = layer_type_name(layer.type);
+        channels = layer.out_channels;
+        samples = layer.out_samples;
+        values += kernel_size(layer) + bias_size(layer);
+    }
+
+    graph.storage = std::make_shared<std::vector<number_t>>(values);
+    number_t *data = graph.storage->data();
+    if (!in.read(reinterpret_cast<char *>(data), values * sizeof(number_t)))
+        throw std::runtime_error("truncated graph file");
+    for (auto &layer : graph.layers) {
+        if (kernel_size(layer) > 0) {
+            layer.kernel = data;
+            data += kernel_size(layer);
+        }
+        if (bias_size(layer) > 0) {
+            layer.bias = data;
+            data += bias_size(layer);
+        }
+    }
+
+    graph.validate();
+    return graph;
+}
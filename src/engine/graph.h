@@ -0,0 +1,63 @@
+#ifndef ENGINE_GRAPH_H
+#define ENGINE_GRAPH_H
+
+#include <memory>
+#include <vector>
+
+#include "layer.h"
+
+// A model as an ordered list of layers, each consuming the output of the previous one.
+// Layers of a loaded graph point into `storage`, which is shared between copies so that they stay valid.
+struct Graph {
+    uint16_t input_channels = 0;
+    uint16_t input_samples = 0;
+    std::vector<Layer> layers;
+    std::shared_ptr<std::vector<number_t>> storage;
+
+    size_t input_size() const {
+        return static_cast<size_t>(input_channels) * input_samples;
+    }
+
+    size_t output_size() const {
+        return layers.empty() ? input_size() : ::output_size(layers.back());
+    }
+
+    size_t macs() const;
+
+    // FNV-1a hash of the shapes, layer parameters and weights: equal for a model and its serialized copy
+    uint64_t hash() const;
+
+    // Per layer, FNV-1a hash of the input shape and of the shapes, parameters and weights of that layer and all those
+    // before it: two graphs compute the same output at layer l for the same input when their hashes at l are equal
+    std::vector<uint64_t> prefix_hashes() const;
+
+    // Copy holding its weights in its own storage, whose values can then be changed through mutable_kernel() and
+    // mutable_bias() without touching the original (e.g. the const tables of the generated model)
+    Graph owned_copy() const;
+    number_t *mutable_kernel(size_t layer);
+    number_t *mutable_bias(size_t layer);
+
+    // Checks that every layer consumes the shape produced by the previous one, throws std::runtime_error otherwise
+    void validate() const;
+
+    // Serialized format (little endian): "GSCG", u16 version, u8 FIXED_POINT, u8 reserved, u16 input channels,
+    // u16 input samples, u16 layer count, then per layer u8 type, u8 activation, u16 out_channels, u16 size,
+    // u16 stride, followed by the kernel and bias values as int16
+    void save(const char *filename) const;
+    static Graph load(const char *filename);
+};
+
+// The model compiled from gsc_output/, with weights pointing at the generated tables
+Graph generated_graph();
+
+// One layer function of gsc_output/ behind flat buffers, named like the matching generated_graph() layer. Flatten is
+// a no-op macro there and has no entry.
+struct GeneratedLayer {
+    const char *name;
+    void (*run)(const number_t *input, number_t *output);
+};
+
+// The generated layer functions in model order
+const std::vector<GeneratedLayer> &generated_layers();
+
+#endif // ENGINE_GRAPH_H
@@ -0,0 +1,73 @@
+#include "head.h"
+
+#include <algorithm>
+
+#include "kernels.h"
+
+Classification argmax(const number_t *logits, size_t count) {
+    Classification result;
+    for (size_t u = 0; u < count; u++) {
+        if (u == 0 || logits[u] > result.logit) {
+            result.label = u;
+            result.logit = logits[u];
+        }
+    }
+    return result;
+}
+
+size_t find_fused_head(const Graph &graph) {
+    const size_t count = graph.layers.size();
+    if (count < 4)
+        return count;
+    const Layer *head = &graph.layers[count - 4];
+    if (head[0].type != LayerType::MaxPool1D || head[1].type != LayerType::AvgPool1D ||
+        head[2].type != LayerType::Flatten || head[3].type != LayerType::Dense || head[3].out_channels > HEAD_MAX_UNITS)
+        return count;
+    return count - 4;
+}
+
+Classification run_fused_head(const Layer *head, const number_t *input, number_t *logits) {
+    const Layer &max_pool = head[0], &avg_pool = head[1], &dense = head[3];
+    const size_t channels = max_pool.in_channels, in_samples = max_pool.in_samples;
+    const size_t pool = max_pool.size, pool_stride = max_pool.stride;
+    const size_t average = avg_pool.size, average_stride = avg_pool.stride, averages = avg_pool.out_samples;
+    const size_t inputs = input_size(dense), units = dense.out_channels;
+    // Linear max pooling starts from the first element, ReLU pooling from 0 like the generated code
+    const bool max_relu = max_pool.activation == Activation::ReLU, avg_relu = avg_pool.activation == Activation::ReLU;
+
+    long_number_t acc[HEAD_MAX_UNITS] = {};
+    for (size_t k = 0; k < channels; k++) {
+        const number_t *in = input + k * in_samples;
+        for (size_t m = 0; m < averages; m++) {
+            long_number_t sum = 0;
+            for (size_t a = 0; a < average; a++) {
+                const number_t *window = in + (m * average_stride + a) * pool_stride;
+                number_t max = max_relu ? 0 : window[0];
+                for (size_t x = 0; x < pool; x++)
+                    max = std::max(max, window[x]);
+                sum += max;
+            }
+            if (avg_relu && sum < 0)
+                sum = 0;
+            // Truncating division, as in the generated average_pooling1d
+            const number_t value = clamp_to_number_t(sum / static_cast<long_number_t>(average));
+
+            // Flatten is a no-op: this average is Dense input k * averages + m
+            const number_t *weights = dense.kernel + k * averages + m;
+            for (size_t u = 0; u < units; u++)
+                acc[u] += weights[u * inputs] * value;
+        }
+    }
+
+    Classification result;
+    for (size_t u = 0; u < units; u++) {
+        const number_t logit = activate(dense.activation, scale_number_t(acc[u]) + dense.bias[u]);
+        if (logits)
+            logits[u] = logit;
+        if (u == 0 || logit > result.logit) {
+            result.label = u;
+            result.logit = logit;
+        }
+    }
+    return result;
+}
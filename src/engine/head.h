@@ -0,0 +1,26 @@
+#ifndef ENGINE_HEAD_H
+#define ENGINE_HEAD_H
+
+#include "graph.h"
+
+// Predicted class: the index of the largest logit (the first one on ties, like std::max_element) and its value
+struct Classification {
+    size_t label = 0;
+    number_t logit = 0;
+};
+
+Classification argmax(const number_t *logits, size_t count);
+
+// Largest Dense layer the fused head keeps all accumulators of in registers
+static const size_t HEAD_MAX_UNITS = 16;
+
+// Index of the first layer of a trailing MaxPool1D -> AvgPool1D -> Flatten -> Dense chain (the classification head of
+// the generated model), or graph.layers.size() when the graph does not end with one
+size_t find_fused_head(const Graph &graph);
+
+// Runs the four head layers in one pass over the MaxPool1D input: each channel's maxima are produced only for the
+// windows the average pool reads, summed as they come, and the average goes straight into the Dense accumulators.
+// Bit-exact with the layer by layer kernels. Writes the logits too when `logits` is not null.
+Classification run_fused_head(const Layer *head, const number_t *input, number_t *logits);
+
+#endif // ENGINE_HEAD_H
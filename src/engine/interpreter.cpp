@@ -0,0 +1,220 @@
+#include "interpreter.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// Bound to const references (vector::assign), so they need a definition at every optimization level
+const size_t ArenaPlan::EXTERNAL;
+const size_t ArenaPlan::INPUT;
+
+static const size_t ARENA_ALIGNMENT = 16;
+
+static size_t align_up(size_t bytes) {
+    return (bytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+namespace {
+struct Tensor {
+    size_t bytes;
+    size_t first; // Producing layer
+    size_t last;  // Last consuming layer
+    size_t offset;
+};
+}
+
+ArenaPlan plan_arena(const Graph &graph, const std::vector<const KernelVariant *> &kernels) {
+    const size_t count = graph.layers.size();
+    ArenaPlan plan;
+    plan.output_offsets.assign(count, ArenaPlan::EXTERNAL);
+
+    // Assign a tensor to every layer output, Flatten reusing the tensor of its input
+    std::vector<Tensor> tensors;
+    std::vector<size_t> tensor_of(count, ArenaPlan::EXTERNAL);
+    for (size_t i = 0; i < count; i++) {
+        const Layer &layer = graph.layers[i];
+        // A Flatten of the model input has no tensor of its own (ArenaPlan::INPUT)
+        if (i > 0 && tensor_of[i - 1] < tensors.size())
+            tensors[tensor_of[i - 1]].last = i;
+
+        if (i == count - 1)
+            break;
+        if (layer.type == LayerType::Flatten) {
+            tensor_of[i] = i > 0 ? tensor_of[i - 1] : ArenaPlan::INPUT;
+        } else {
+            tensor_of[i] = tensors.size();
+            tensors.push_back({align_up(output_size(layer) * sizeof(number_t)), i, i, 0});
+        }
+    }
+
+    // Greedy placement, largest tensors first, at the lowest offset that does not collide with an already placed
+    // tensor alive at the same time
+    std::vector<size_t> order(tensors.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return tensors[a].bytes > tensors[b].bytes; });
+
+    std::vector<size_t> placed;
+    size_t tensors_end = 0;
+    for (size_t t : order) {
+        Tensor &tensor = tensors[t];
+        std::vector<const Tensor *> conflicts;
+        for (size_t p : placed) {
+            const Tensor &other = tensors[p];
+            if (other.first <= tensor.last && tensor.first <= other.last)
+                conflicts.push_back(&other);
+        }
+        std::sort(conflicts.begin(), conflicts.end(), [](const Tensor *a, const Tensor *b) { return a->offset < b->offset; });
+
+        size_t offset = 0;
+        for (const Tensor *other : conflicts) {
+            if (offset + tensor.bytes <= other->offset)
+                break;
+            offset = std::max(offset, other->offset + other->bytes);
+        }
+        tensor.offset = offset;
+        tensors_end = std::max(tensors_end, offset + tensor.bytes);
+        placed.push_back(t);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (tensor_of[i] == ArenaPlan::INPUT)
+            plan.output_offsets[i] = ArenaPlan::INPUT;
+        else if (tensor_of[i] != ArenaPlan::EXTERNAL)
+            plan.output_offsets[i] = tensors[tensor_of[i]].offset;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        plan.scratch_bytes = std::max(plan.scratch_bytes, align_up(kernels[i]->scratch_bytes(graph.layers[i])));
+    plan.scratch_offset = tensors_end;
+    plan.arena_bytes = tensors_end + plan.scratch_bytes;
+    return plan;
+}
+
+Interpreter::Interpreter(Graph graph) : graph_(std::move(graph)) {
+    graph_.validate();
+    for (const auto &layer : graph_.layers) {
+        const KernelVariant *kernel = find_kernel(layer);
+        if (!kernel)
+            throw std::runtime_error(std::string("no kernel for layer ") + layer.name);
+        kernels_.push_back(kernel);
+        states_.push_back(kernel->prepare ? kernel->prepare(layer) : nullptr);
+    }
+    head_ = find_fused_head(graph_);
+    logits_.resize(graph_.output_size());
+    replan();
+}
+
+bool Interpreter::select(size_t layer, const char *variant) {
+    const KernelVariant *kernel = find_kernel(graph_.layers.at(layer), variant);
+    if (!kernel)
+        return false;
+    kernels_[layer] = kernel;
+    states_[layer] = kernel->prepare ? kernel->prepare(graph_.layers[layer]) : nullptr;
+    replan();
+    return true;
+}
+
+void Interpreter::set_pool(WorkerPool *pool) {
+    pool_ = pool;
+    replan();
+}
+
+void Interpreter::replan() {
+    plan_ = plan_arena(graph_, kernels_);
+    arena_.assign(plan_.arena_bytes / sizeof(long_number_t) + 1, 0);
+
+    const size_t threads = pool_ ? pool_->threads() : 1;
+    slices_.clear();
+    slice_scratch_bytes_ = 0;
+    for (size_t i = 0; i < graph_.layers.size(); i++) {
+        slices_.push_back(parallel_slices(graph_.layers[i], kernels_[i], threads));
+        for (const LayerSlice &slice : slices_.back())
+            slice_scratch_bytes_ = std::max(slice_scratch_bytes_, align_up(kernels_[i]->scratch_bytes(slice.layer)));
+    }
+    slice_scratch_.assign(threads * slice_scratch_bytes_ / sizeof(long_number_t) + 1, 0);
+}
+
+void Interpreter::run(const number_t *input, number_t *output) {
+    run_layers(input, output, graph_.layers.size());
+}
+
+Classification Interpreter::classify(const number_t *input, number_t *logits) {
+    if (head_ == graph_.layers.size()) {
+        number_t *output = logits ? logits : logits_.data();
+        run(input, output);
+        return argmax(output, graph_.output_size());
+    }
+    // The head input is never the model output, so the prefix leaves it in the arena (or it is the input itself)
+    return run_fused_head(&graph_.layers[head_], run_layers(input, nullptr, head_), logits);
+}
+
+const number_t *Interpreter::run_layers(const number_t *input, number_t *output, size_t end) {
+    char *arena = reinterpret_cast<char *>(arena_.data());
+    void *scratch = arena + plan_.scratch_offset;
+
+    const number_t *in = input;
+    for (size_t i = 0; i < end; i++) {
+        const size_t offset = plan_.output_offsets[i];
+        number_t *out;
+        if (offset == ArenaPlan::EXTERNAL)
+            out = output;
+        else if (offset == ArenaPlan::INPUT)
+            out = const_cast<number_t *>(input); // Flatten of the model input, never written to
+        else
+            out = reinterpret_cast<number_t *>(arena + offset);
+        if (slices_[i].empty())
+            kernels_[i]->run(graph_.layers[i], in, out, scratch, states_[i].get());
+        else
+            run_slices(i, in, out);
+        in = out;
+    }
+    return in;
+}
+
+void Interpreter::run_slices(size_t index, const number_t *input, number_t *output) {
+    const KernelVariant *kernel = kernels_[index];
+    const std::vector<LayerSlice> &slices = slices_[index];
+    char *scratch = reinterpret_cast<char *>(slice_scratch_.data());
+    auto run_slice = [&](size_t t) {
+        const LayerSlice &slice = slices[t];
+        kernel->run(slice.layer, input + slice.input_offset, output + slice.output_offset,
+                    scratch + t * slice_scratch_bytes_, slice.state.get());
+    };
+    pool_->run(run_slice);
+}
+
+void Interpreter::run_batch(const number_t *inputs, number_t *outputs, size_t count) {
+    // Every arena offset scaled by count keeps its alignment and leaves room for count tensors back to back
+    const size_t elements = count * plan_.arena_bytes / sizeof(long_number_t) + 1;
+    if (batch_arena_.size() < elements)
+        batch_arena_.assign(elements, 0);
+    char *arena = reinterpret_cast<char *>(batch_arena_.data());
+    void *scratch = arena + count * plan_.scratch_offset;
+
+    const number_t *in = inputs;
+    for (size_t i = 0; i < graph_.layers.size(); i++) {
+        const Layer &layer = graph_.layers[i];
+        const size_t offset = plan_.output_offsets[i];
+        number_t *out;
+        if (offset == ArenaPlan::EXTERNAL)
+            out = outputs;
+        else if (offset == ArenaPlan::INPUT)
+            out = const_cast<number_t *>(inputs);
+        else
+            out = reinterpret_cast<number_t *>(arena + count * offset);
+
+        if (kernels_[i]->run_batch) {
+            kernels_[i]->run_batch(layer, in, out, count, scratch, states_[i].get());
+        } else {
+            for (size_t b = 0; b < count; b++)
+                kernels_[i]->run(layer, in + b * input_size(layer), out + b * output_size(layer), scratch, states_[i].get());
+        }
+        in = out;
+    }
+}
+
+void Interpreter::run_layer(size_t index, const number_t *input, number_t *output) {
+    char *arena = reinterpret_cast<char *>(arena_.data());
+    kernels_.at(index)->run(graph_.layers[index], input, output, arena + plan_.scratch_offset, states_[index].get());
+}
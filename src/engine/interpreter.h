@@ -0,0 +1,102 @@
+#ifndef ENGINE_INTERPRETER_H
+#define ENGINE_INTERPRETER_H
+
+#include <vector>
+
+#include "graph.h"
+#include "head.h"
+#include "kernels.h"
+#include "parallel.h"
+
+// Placement of every intermediate tensor in a single arena. Each non-Flatten layer produces a tensor that lives until
+// its last consumer ran; tensors whose lifetimes overlap get disjoint offsets, the others share memory, which for a
+// chain like the generated model reproduces its two activations unions. The last layer writes straight to the caller's
+// output and the first one reads the caller's input, like cnn().
+struct ArenaPlan {
+    static const size_t EXTERNAL = static_cast<size_t>(-1);
+    static const size_t INPUT = static_cast<size_t>(-2);
+
+    // Byte offset of each layer output in the arena, EXTERNAL for the model output, INPUT for a Flatten of the input
+    std::vector<size_t> output_offsets;
+    size_t scratch_offset = 0;          // Shared kernel scratch, only used during one layer at a time
+    size_t scratch_bytes = 0;
+    size_t arena_bytes = 0;
+};
+
+ArenaPlan plan_arena(const Graph &graph, const std::vector<const KernelVariant *> &kernels);
+
+// Executes a graph layer by layer against one planned arena. Instances are independent of each other, so one
+// interpreter per thread can run concurrently.
+class Interpreter {
+public:
+    explicit Interpreter(Graph graph);
+    Interpreter(const Interpreter &) = delete;
+    Interpreter &operator=(const Interpreter &) = delete;
+
+    // Replaces the kernel of one layer by the named variant, returns false if no such variant supports the layer
+    bool select(size_t layer, const char *variant);
+
+    const Graph &graph() const {
+        return graph_;
+    }
+
+    const std::vector<const KernelVariant *> &kernels() const {
+        return kernels_;
+    }
+
+    const ArenaPlan &plan() const {
+        return plan_;
+    }
+
+    // Data prepared by the selected kernel of a layer, null if the variant has no prepare()
+    void *state(size_t layer) const {
+        return states_[layer].get();
+    }
+
+    // input: [input_channels][input_samples], output: graph().output_size() values
+    void run(const number_t *input, number_t *output);
+
+    // Runs the model and returns its predicted class. A trailing MaxPool1D -> AvgPool1D -> Flatten -> Dense head (see
+    // find_fused_head) runs fused instead of with the selected kernels; the logits are also written when `logits` is
+    // not null.
+    Classification classify(const number_t *input, number_t *logits = nullptr);
+
+    // Runs `count` inputs stored back to back, layer by layer over the whole batch so that kernels with a batch path
+    // (see KernelVariant::run_batch) see all inputs at once. The batch arena is the planned one scaled by count.
+    void run_batch(const number_t *inputs, number_t *outputs, size_t count);
+
+    // Splits the layers worth it (see parallel_slices) across the pool's threads in run() and classify(), null goes
+    // back to one thread. The pool must outlive its use and serve one interpreter at a time; run_batch() and
+    // run_layer() always stay on the calling thread.
+    void set_pool(WorkerPool *pool);
+
+    // Slices of a layer under the current pool, empty if it runs on one thread
+    const std::vector<LayerSlice> &slices(size_t layer) const {
+        return slices_[layer];
+    }
+
+    // Runs a single layer with its selected kernel between caller buffers, using the arena scratch
+    void run_layer(size_t index, const number_t *input, number_t *output);
+
+private:
+    void replan();
+
+    // Runs layers [0, end) and returns the output of the last one
+    const number_t *run_layers(const number_t *input, number_t *output, size_t end);
+    void run_slices(size_t index, const number_t *input, number_t *output);
+
+    Graph graph_;
+    std::vector<const KernelVariant *> kernels_;
+    std::vector<std::shared_ptr<void>> states_;
+    ArenaPlan plan_;
+    size_t head_; // First layer of the fused head, graph_.layers.size() without one
+    std::vector<number_t> logits_;
+    std::vector<long_number_t> arena_; // long_number_t elements keep the arena suitably aligned for scratch use
+    std::vector<long_number_t> batch_arena_;
+    WorkerPool *pool_ = nullptr;
+    std::vector<std::vector<LayerSlice>> slices_;
+    size_t slice_scratch_bytes_ = 0; // Scratch of each slice, back to back in slice_scratch_
+    std::vector<long_number_t> slice_scratch_;
+};
+
+#endif // ENGINE_INTERPRETER_H
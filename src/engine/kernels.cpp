@@ -0,0 +1,188 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "fixed.h"
+#include "gemm.h"
+#include "pooling.h"
+#include "pruned.h"
+#include "ranges.h"
+#include "sparse.h"
+#include "winograd.h"
+
+// Layer fields are copied to locals in every kernel: number_t stores may alias the uint16_t shape fields, which would
+// otherwise force the compiler to reload them inside the inner loops.
+
+// Accumulates over all input channels and taps for one filter at a time, with the output positions in the inner loop
+// so that the multiply-accumulates vectorize. Small compile-time kernel sizes add all taps of a channel in a single
+// pass over the accumulators. Integer sums are associative, so the result matches the generated per-channel
+// kernel_mac ordering exactly.
+template<size_t Size>
+static void conv1d_rows(const Layer &layer, const number_t *input, number_t *output, long_number_t *acc) {
+    const size_t in_channels = layer.in_channels, in_samples = layer.in_samples;
+    const size_t filters = layer.out_channels, out_samples = layer.out_samples;
+    const size_t size = Size ? Size : layer.size, stride = layer.stride;
+    const Activation activation = layer.activation;
+
+    for (size_t k = 0; k < filters; k++) {
+        std::fill(acc, acc + out_samples, 0);
+        const number_t *filter = layer.kernel + k * in_channels * size;
+
+        for (size_t z = 0; z < in_channels; z++) {
+            const number_t *in = input + z * in_samples;
+            const number_t *w = filter + z * size;
+            if (Size > 0) {
+                for (size_t pos_x = 0; pos_x < out_samples; pos_x++) {
+                    long_number_t sum = 0;
+                    for (size_t x = 0; x < Size; x++)
+                        sum += in[pos_x + x] * w[x];
+                    acc[pos_x] += sum;
+                }
+            } else if (stride == 1) {
+                for (size_t x = 0; x < size; x++)
+                    for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+                        acc[pos_x] += in[pos_x + x] * w[x];
+            } else {
+                for (size_t x = 0; x < size; x++)
+                    for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+                        acc[pos_x] += in[pos_x * stride + x] * w[x];
+            }
+        }
+
+        const long_number_t bias = layer.bias[k];
+        number_t *out = output + k * out_samples;
+        for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+            out[pos_x] = activate(activation, scale_number_t(acc[pos_x]) + bias);
+    }
+}
+
+void conv1d_generic(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *) {
+    long_number_t *acc = static_cast<long_number_t *>(scratch);
+    if (layer.stride == 1 && layer.size == 3)
+        conv1d_rows<3>(layer, input, output, acc);
+    else if (layer.stride == 1 && layer.size == 5)
+        conv1d_rows<5>(layer, input, output, acc);
+    else
+        conv1d_rows<0>(layer, input, output, acc);
+}
+
+// Window loop with a compile-time size so that common pool sizes unroll into branchless max chains
+template<size_t Size>
+static void max_pool1d_rows(const Layer &layer, const number_t *input, number_t *output) {
+    const size_t channels = layer.in_channels, in_samples = layer.in_samples, out_samples = layer.out_samples;
+    const size_t size = Size ? Size : layer.size, stride = layer.stride;
+    // Linear pooling starts from the first element, ReLU pooling from 0 like the generated code
+    const bool relu = layer.activation == Activation::ReLU;
+
+    for (size_t k = 0; k < channels; k++) {
+        const number_t *in = input + k * in_samples;
+        number_t *out = output + k * out_samples;
+        for (size_t pos_x = 0; pos_x < out_samples; pos_x++) {
+            const number_t *window = in + pos_x * stride;
+            number_t max = relu ? 0 : window[0];
+            for (size_t x = 0; x < size; x++)
+                max = std::max(max, window[x]);
+            out[pos_x] = max;
+        }
+    }
+}
+
+void max_pool1d_generic(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    switch (layer.size) {
+        case 2:
+            return max_pool1d_rows<2>(layer, input, output);
+        case 4:
+            return max_pool1d_rows<4>(layer, input, output);
+        case 8:
+            return max_pool1d_rows<8>(layer, input, output);
+        default:
+            return max_pool1d_rows<0>(layer, input, output);
+    }
+}
+
+void avg_pool1d_generic(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    const size_t channels = layer.in_channels, in_samples = layer.in_samples, out_samples = layer.out_samples;
+    const size_t size = layer.size, stride = layer.stride;
+    const bool relu = layer.activation == Activation::ReLU;
+
+    for (size_t k = 0; k < channels; k++) {
+        const number_t *in = input + k * in_samples;
+        number_t *out = output + k * out_samples;
+        for (size_t pos_x = 0; pos_x < out_samples; pos_x++) {
+            long_number_t tmp = 0;
+            for (size_t x = 0; x < size; x++)
+                tmp += in[pos_x * stride + x];
+            if (relu && tmp < 0)
+                tmp = 0;
+            // Truncating division, as in the generated average_pooling1d
+            out[pos_x] = clamp_to_number_t(tmp / static_cast<long_number_t>(size));
+        }
+    }
+}
+
+// The generated flatten is a no-op on channels-first data; the interpreter aliases its buffers so this only copies
+// when asked to write somewhere else (e.g. a model whose last layer is Flatten)
+void flatten_generic(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    if (input != output)
+        std::memmove(output, input, input_size(layer) * sizeof(number_t));
+}
+
+void dense_generic(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    const size_t inputs = input_size(layer), units = layer.out_channels;
+    const Activation activation = layer.activation;
+
+    for (size_t k = 0; k < units; k++) {
+        const number_t *weights = layer.kernel + k * inputs;
+        long_number_t acc = 0;
+        for (size_t z = 0; z < inputs; z++)
+            acc += weights[z] * input[z];
+        output[k] = activate(activation, scale_number_t(acc) + layer.bias[k]);
+    }
+}
+
+static bool supports_any(const Layer &) {
+    return true;
+}
+
+static size_t no_scratch(const Layer &) {
+    return 0;
+}
+
+static size_t conv1d_generic_scratch(const Layer &layer) {
+    return layer.out_samples * sizeof(long_number_t);
+}
+
+const std::vector<KernelVariant> &kernel_variants() {
+    static const std::vector<KernelVariant> variants = {
+        {"generic", LayerType::Conv1D, supports_any, conv1d_generic_scratch, conv1d_generic, nullptr, nullptr},
+        {"generic", LayerType::MaxPool1D, supports_any, no_scratch, max_pool1d_generic, nullptr, nullptr},
+        {"generic", LayerType::AvgPool1D, supports_any, no_scratch, avg_pool1d_generic, nullptr, nullptr},
+        {"generic", LayerType::Flatten, supports_any, no_scratch, flatten_generic, nullptr, nullptr},
+        {"generic", LayerType::Dense, supports_any, no_scratch, dense_generic, nullptr, nullptr},
+        {"sparse", LayerType::Conv1D, conv1d_sparse_supports, conv1d_sparse_scratch, conv1d_sparse, conv1d_sparse_prepare, nullptr},
+        {"winograd", LayerType::Conv1D, conv1d_winograd_supports, conv1d_winograd_scratch, conv1d_winograd, conv1d_winograd_prepare, nullptr},
+        {"gemm", LayerType::Conv1D, supports_any, conv1d_gemm_scratch, conv1d_gemm, conv1d_gemm_prepare, conv1d_gemm_batch},
+        {"pruned", LayerType::Conv1D, supports_any, conv1d_pruned_scratch, conv1d_pruned, pruned_prepare, nullptr},
+        {"pruned", LayerType::Dense, supports_any, no_scratch, dense_pruned, pruned_prepare, nullptr},
+        {"fixed", LayerType::Conv1D, supports_any, no_scratch, conv1d_fixed, nullptr, nullptr},
+        {"fixed", LayerType::MaxPool1D, supports_any, no_scratch, max_pool1d_fixed, nullptr, nullptr},
+        {"fixed", LayerType::AvgPool1D, supports_any, no_scratch, avg_pool1d_fixed, nullptr, nullptr},
+        {"fixed", LayerType::Dense, supports_any, no_scratch, dense_fixed, nullptr, nullptr},
+        {"narrow", LayerType::Conv1D, narrow_supports, conv1d_narrow_scratch, conv1d_narrow, nullptr, nullptr},
+        {"narrow", LayerType::Dense, narrow_supports, no_scratch, dense_narrow, nullptr, nullptr},
+        {"simd", LayerType::MaxPool1D, max_pool1d_simd_supports, no_scratch, max_pool1d_simd, nullptr, nullptr},
+        {"simd", LayerType::AvgPool1D, avg_pool1d_simd_supports, no_scratch, avg_pool1d_simd, nullptr, nullptr},
+    };
+    return variants;
+}
+
+const KernelVariant *find_kernel(const Layer &layer, const char *name) {
+    for (const auto &variant : kernel_variants()) {
+        if (variant.type != layer.type || !variant.supports(layer))
+            continue;
+        if (name == nullptr || std::strcmp(name, variant.name) == 0)
+            return &variant;
+    }
+    return nullptr;
+}
@@ -0,0 +1,52 @@
+#ifndef ENGINE_KERNELS_H
+#define ENGINE_KERNELS_H
+
+#include <memory>
+#include <vector>
+
+#include "layer.h"
+
+// Every kernel reads a [in_channels][in_samples] tensor and writes a [out_channels][out_samples] tensor.
+// `scratch` points to at least scratch_bytes(layer) bytes of 16-byte aligned memory owned by the caller, so that
+// kernels never rely on static buffers and several interpreters can run concurrently. `state` is what the variant's
+// prepare() returned for this layer (null for variants without one).
+typedef void (*KernelFn)(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+
+// Same for `count` inputs and outputs stored back to back, with count * scratch_bytes(layer) bytes of scratch
+typedef void (*BatchKernelFn)(const Layer &layer, const number_t *input, number_t *output, size_t count, void *scratch,
+                              void *state);
+
+// One implementation of a layer type. Variants of the same type must produce bit-identical outputs.
+struct KernelVariant {
+    const char *name;
+    LayerType type;
+    bool (*supports)(const Layer &layer);
+    size_t (*scratch_bytes)(const Layer &layer);
+    KernelFn run;
+    // Optional, builds per-layer data once when the variant is selected (reordered weights, statistics, ...)
+    std::shared_ptr<void> (*prepare)(const Layer &layer);
+    // Optional, processes a whole batch in one call where that is cheaper than calling run() per input
+    BatchKernelFn run_batch;
+};
+
+// All registered variants, the portable "generic" ones first
+const std::vector<KernelVariant> &kernel_variants();
+
+// Returns the variant called `name` able to run `layer`, or the first one able to when `name` is null
+const KernelVariant *find_kernel(const Layer &layer, const char *name = nullptr);
+
+// Portable kernels, bit-exact with the code generated in gsc_output/ for any shape
+void conv1d_generic(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void max_pool1d_generic(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void avg_pool1d_generic(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void flatten_generic(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void dense_generic(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+
+// Applies the layer activation and saturation to an accumulator that already went through scale_number_t() + bias
+static inline number_t activate(Activation activation, long_number_t acc) {
+    if (activation == Activation::ReLU && acc < 0)
+        return 0;
+    return clamp_to_number_t(acc);
+}
+
+#endif // ENGINE_KERNELS_H
@@ -0,0 +1,99 @@
+#ifndef ENGINE_LAYER_H
+#define ENGINE_LAYER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "number.h"
+
+// Layer kinds understood by the interpreter, matching the Keras layers used in training.py
+enum class LayerType : uint8_t {
+    Conv1D = 0,
+    MaxPool1D = 1,
+    AvgPool1D = 2,
+    Flatten = 3,
+    Dense = 4,
+};
+
+enum class Activation : uint8_t {
+    Linear = 0,
+    ReLU = 1,
+};
+
+// Shape and parameters of one layer. Tensors are stored channels-first ([channels][samples]) like the generated code.
+// For Conv1D `size` is the kernel size and `out_channels` the number of filters, for pooling layers `size` is the
+// pool size, for Dense `out_channels` is the number of units and inputs/outputs have a single sample.
+struct Layer {
+    LayerType type;
+    Activation activation;
+    uint16_t in_channels;
+    uint16_t in_samples;
+    uint16_t out_channels;
+    uint16_t out_samples;
+    uint16_t size;
+    uint16_t stride;
+    const number_t *kernel; // [out_channels][in_channels][size] for Conv1D, [out_channels][in_channels*in_samples] for Dense
+    const number_t *bias;   // [out_channels]
+    const char *name;
+};
+
+inline size_t input_size(const Layer &layer) {
+    return static_cast<size_t>(layer.in_channels) * layer.in_samples;
+}
+
+inline size_t output_size(const Layer &layer) {
+    return static_cast<size_t>(layer.out_channels) * layer.out_samples;
+}
+
+inline size_t kernel_size(const Layer &layer) {
+    switch (layer.type) {
+        case LayerType::Conv1D:
+            return static_cast<size_t>(layer.out_channels) * layer.in_channels * layer.size;
+        case LayerType::Dense:
+            return static_cast<size_t>(layer.out_channels) * input_size(layer);
+        default:
+            return 0;
+    }
+}
+
+inline size_t bias_size(const Layer &layer) {
+    return layer.type == LayerType::Conv1D || layer.type == LayerType::Dense ? layer.out_channels : 0;
+}
+
+// Multiply-accumulate count of one inference through the layer (0 for weightless layers)
+inline size_t macs(const Layer &layer) {
+    switch (layer.type) {
+        case LayerType::Conv1D:
+            return output_size(layer) * layer.in_channels * layer.size;
+        case LayerType::Dense:
+            return output_size(layer) * input_size(layer);
+        default:
+            return 0;
+    }
+}
+
+// Fills out_channels/out_samples from the input shape and layer parameters (valid padding only, like the generator).
+// A Flatten of more than UINT16_MAX values wraps; Graph::validate() rejects it.
+inline void infer_output_shape(Layer &layer) {
+    switch (layer.type) {
+        case LayerType::Conv1D:
+            layer.out_samples = (layer.in_samples - layer.size) / layer.stride + 1;
+            break;
+        case LayerType::MaxPool1D:
+        case LayerType::AvgPool1D:
+            layer.out_channels = layer.in_channels;
+            layer.out_samples = (layer.in_samples - layer.size) / layer.stride + 1;
+            break;
+        case LayerType::Flatten:
+            layer.out_channels = layer.in_channels * layer.in_samples;
+            layer.out_samples = 1;
+            break;
+        case LayerType::Dense:
+            layer.out_samples = 1;
+            break;
+    }
+}
+
+const char *layer_type_name(LayerType type);
+
+#endif // ENGINE_LAYER_H
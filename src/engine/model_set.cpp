@@ -0,0 +1,78 @@
+#include "model_set.h"
+
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+ModelSet::ModelSet(const std::vector<Graph> &graphs) {
+    if (graphs.empty())
+        throw std::runtime_error("a model set needs at least one model");
+    std::map<std::pair<size_t, uint64_t>, size_t> nodes; // (layer, prefix hash) -> node
+    for (size_t c = 0; c < graphs.size(); c++) {
+        if (graphs[c].input_size() != graphs[0].input_size())
+            throw std::runtime_error("model " + std::to_string(c) + " takes " + std::to_string(graphs[c].input_size()) +
+                                     " input values instead of " + std::to_string(graphs[0].input_size()));
+        interpreters_.emplace_back(new Interpreter(graphs[c]));
+        const std::vector<uint64_t> hashes = graphs[c].prefix_hashes();
+        std::vector<size_t> path;
+        for (size_t l = 0; l < hashes.size(); l++) {
+            auto inserted = nodes.insert({{l, hashes[l]}, nodes_.size()});
+            if (inserted.second) {
+                Node node;
+                node.layer = l;
+                node.candidate = c;
+                node.parent = l == 0 ? NO_PARENT : path.back();
+                node.output.resize(output_size(graphs[c].layers[l]));
+                nodes_.push_back(std::move(node));
+            }
+            nodes_[inserted.first->second].users++;
+            path.push_back(inserted.first->second);
+        }
+        paths_.push_back(std::move(path));
+    }
+}
+
+void ModelSet::classify(const number_t *input, size_t *labels) {
+    for (Node &node : nodes_) {
+        const number_t *in = node.parent == NO_PARENT ? input : nodes_[node.parent].output.data();
+        const auto start = std::chrono::steady_clock::now();
+        interpreters_[node.candidate]->run_layer(node.layer, in, node.output.data());
+        node.ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+    for (size_t c = 0; c < paths_.size(); c++) {
+        const Graph &graph = interpreters_[c]->graph();
+        labels[c] = paths_[c].empty() ? argmax(input, graph.output_size()).label
+                                      : argmax(nodes_[paths_[c].back()].output.data(), graph.output_size()).label;
+    }
+    inputs_++;
+}
+
+size_t ModelSet::shared_layers(size_t candidate) const {
+    size_t shared = 0;
+    for (size_t node : paths_[candidate])
+        shared += nodes_[node].users > 1;
+    return shared;
+}
+
+size_t ModelSet::separate_layer_runs() const {
+    size_t runs = 0;
+    for (const std::vector<size_t> &path : paths_)
+        runs += path.size();
+    return runs;
+}
+
+double ModelSet::alone_ns(size_t candidate) const {
+    double ns = 0;
+    for (size_t node : paths_[candidate])
+        ns += nodes_[node].ns;
+    return inputs_ ? ns / inputs_ : 0;
+}
+
+double ModelSet::share_ns(size_t candidate) const {
+    double ns = 0;
+    for (size_t node : paths_[candidate])
+        ns += nodes_[node].ns / nodes_[node].users;
+    return inputs_ ? ns / inputs_ : 0;
+}
@@ -0,0 +1,64 @@
+#ifndef ENGINE_MODEL_SET_H
+#define ENGINE_MODEL_SET_H
+
+#include <memory>
+#include <vector>
+
+#include "interpreter.h"
+
+// Candidate models evaluated side by side on the same inputs, one interpreter each: unlike the generated model.c, whose
+// global symbols clash when two of them are linked, any number of serialized graphs live in one process. The leading
+// layers several candidates have in common (equal Graph::prefix_hashes(), e.g. the weightless first max pooling, or a
+// whole trunk when only the head was retrained) form one node of a prefix tree and run once per input for all of them.
+class ModelSet {
+public:
+    // The graphs must take inputs of the same size
+    explicit ModelSet(const std::vector<Graph> &graphs);
+    ModelSet(const ModelSet &) = delete;
+    ModelSet &operator=(const ModelSet &) = delete;
+
+    size_t size() const {
+        return paths_.size();
+    }
+
+    Interpreter &interpreter(size_t candidate) {
+        return *interpreters_[candidate];
+    }
+
+    // Runs every candidate on `input` and writes its predicted class to labels[candidate]
+    void classify(const number_t *input, size_t *labels);
+
+    // Layers of a candidate that run in a node shared with other candidates
+    size_t shared_layers(size_t candidate) const;
+
+    // Layer runs per input for the whole set, and what evaluating the candidates one by one would take
+    size_t layer_runs() const {
+        return nodes_.size();
+    }
+
+    size_t separate_layer_runs() const;
+
+    // Mean time per input of the layers of a candidate, counting shared nodes in full (the candidate run alone) or
+    // split between the candidates sharing them (its share of the set)
+    double alone_ns(size_t candidate) const;
+    double share_ns(size_t candidate) const;
+
+private:
+    static const size_t NO_PARENT = static_cast<size_t>(-1);
+
+    struct Node {
+        size_t layer;
+        size_t candidate; // Whose interpreter runs the layer
+        size_t parent;    // Node whose output is the input, NO_PARENT for the model input
+        size_t users = 0; // Candidates going through the node
+        std::vector<number_t> output;
+        double ns = 0;    // Total time spent running it
+    };
+
+    std::vector<std::unique_ptr<Interpreter>> interpreters_;
+    std::vector<Node> nodes_;                // Parents before their children
+    std::vector<std::vector<size_t>> paths_; // Node of each layer of each candidate
+    size_t inputs_ = 0;
+};
+
+#endif // ENGINE_MODEL_SET_H
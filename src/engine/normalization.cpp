@@ -0,0 +1,42 @@
+#include "normalization.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+static number_t fold_value(double value, const Layer &layer) {
+    const long rounded = std::lround(value);
+    if (rounded < NUMBER_MIN || rounded > NUMBER_MAX)
+        throw std::runtime_error(std::string("folded normalization overflows the weights of layer ") + layer.name);
+    return static_cast<number_t>(rounded);
+}
+
+Graph fold_input_normalization(const Graph &graph, const InputNormalization &normalization) {
+    if (!(normalization.std > 0))
+        throw std::runtime_error("input normalization needs a positive standard deviation");
+
+    Graph folded = graph.owned_copy();
+    for (size_t l = 0; l < folded.layers.size(); l++) {
+        const Layer &layer = folded.layers[l];
+        if (layer.type == LayerType::MaxPool1D)
+            continue;
+        if (layer.type != LayerType::Conv1D)
+            throw std::runtime_error(std::string("cannot fold the input normalization through layer ") + layer.name);
+
+        const double scale = (1 << FIXED_POINT) / static_cast<double>(normalization.std);
+        const double shift = normalization.mean / static_cast<double>(normalization.std);
+        const size_t filter_size = layer.in_channels * layer.size;
+        number_t *kernel = folded.mutable_kernel(l);
+        number_t *bias = folded.mutable_bias(l);
+        for (size_t k = 0; k < layer.out_channels; k++) {
+            long sum = 0;
+            for (size_t i = k * filter_size; i < (k + 1) * filter_size; i++) {
+                sum += kernel[i];
+                kernel[i] = fold_value(kernel[i] * scale, layer);
+            }
+            bias[k] = fold_value(bias[k] - shift * sum, layer);
+        }
+        return folded;
+    }
+    throw std::runtime_error("no Conv1D layer to fold the input normalization into");
+}
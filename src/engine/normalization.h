@@ -0,0 +1,18 @@
+#ifndef ENGINE_NORMALIZATION_H
+#define ENGINE_NORMALIZATION_H
+
+#include "graph.h"
+
+// Normalization (x - mean) / std that training applied to the raw samples, as exported in normalization.csv
+struct InputNormalization {
+    float mean = 0;
+    float std = 1;
+};
+
+// Copy of a model trained on normalized inputs that takes raw int16 samples instead, read as fixed-point numbers like
+// the firmware does. The normalization commutes with the MaxPool1D layers in front of the first Conv1D and is folded
+// into its weights (scaled by 2^FIXED_POINT / std) and bias (minus mean / std times the sum of each filter's weights).
+// Throws std::runtime_error when another layer comes first or a folded value does not fit number_t.
+Graph fold_input_normalization(const Graph &graph, const InputNormalization &normalization);
+
+#endif // ENGINE_NORMALIZATION_H
@@ -0,0 +1,206 @@
+#include "parallel.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline void cpu_relax() {
+#if defined(__SSE2__)
+    _mm_pause();
+#endif
+}
+
+WorkerPool::WorkerPool(size_t threads) {
+    for (size_t slice = 1; slice < threads; slice++)
+        workers_.emplace_back(&WorkerPool::work, this, slice);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(true, std::memory_order_release);
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+    wake_.notify_all();
+    for (std::thread &worker : workers_)
+        worker.join();
+}
+
+void WorkerPool::dispatch(SliceFn fn, void *context) {
+    if (workers_.empty()) {
+        fn(context, 0);
+        return;
+    }
+    fn_ = fn;
+    context_ = context;
+    pending_.store(workers_.size(), std::memory_order_relaxed);
+    {
+        // Bumped under the mutex so that a worker about to park sees either the new generation or the notification
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+    wake_.notify_all();
+
+    fn(context, 0);
+    for (size_t spins = 0; pending_.load(std::memory_order_acquire) != 0; spins++) {
+        if (spins < PARALLEL_SPIN)
+            cpu_relax();
+        else
+            std::this_thread::yield();
+    }
+}
+
+void WorkerPool::work(size_t slice) {
+    size_t seen = 0;
+    for (;;) {
+        size_t generation = generation_.load(std::memory_order_acquire);
+        for (size_t spins = 0; generation == seen && spins < PARALLEL_SPIN; spins++) {
+            cpu_relax();
+            generation = generation_.load(std::memory_order_acquire);
+        }
+        if (generation == seen) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return generation_.load(std::memory_order_acquire) != seen; });
+            generation = generation_.load(std::memory_order_acquire);
+        }
+        seen = generation;
+
+        if (stop_.load(std::memory_order_acquire))
+            return;
+        fn_(context_, slice);
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+StealingPool::StealingPool(size_t threads) {
+    threads = std::max<size_t>(1, threads);
+    for (size_t worker = 0; worker < threads; worker++)
+        queues_.emplace_back(new Queue());
+    for (size_t worker = 0; worker < threads; worker++)
+        workers_.emplace_back(&StealingPool::work, this, worker);
+}
+
+StealingPool::~StealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &worker : workers_)
+        worker.join();
+}
+
+void StealingPool::submit(size_t hint, Task task) {
+    Queue &queue = *queues_[hint % queues_.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_++;
+        unfinished_++;
+    }
+    wake_.notify_one();
+}
+
+void StealingPool::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [&] { return unfinished_ == 0; });
+}
+
+bool StealingPool::pop(size_t worker, Task &task) {
+    {
+        Queue &own = *queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues_.size(); i++) {
+        Queue &victim = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void StealingPool::work(size_t worker) {
+    Task task;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // queued_ counts tasks pushed but not popped yet, so a worker only parks when there is nothing to take
+            wake_.wait(lock, [&] { return queued_ > 0 || stop_; });
+            if (queued_ == 0)
+                return;
+            queued_--;
+        }
+        // The count reserved one task, which some deque holds until this worker (or a thief) takes it
+        while (!pop(worker, task))
+            std::this_thread::yield();
+        task(worker);
+        task = nullptr;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--unfinished_ == 0)
+            idle_.notify_all();
+    }
+}
+
+std::vector<LayerSlice> parallel_slices(const Layer &layer, const KernelVariant *kernel, size_t threads) {
+    std::vector<LayerSlice> slices;
+    size_t work;
+    switch (layer.type) {
+        case LayerType::Conv1D:
+        case LayerType::Dense:
+            work = macs(layer);
+            break;
+        case LayerType::MaxPool1D:
+        case LayerType::AvgPool1D:
+            work = input_size(layer);
+            break;
+        default:
+            return slices;
+    }
+    const size_t channels = layer.out_channels;
+    if (threads < 2 || channels < threads || work / threads < PARALLEL_MIN_WORK)
+        return slices;
+
+    for (size_t t = 0; t < threads; t++) {
+        const size_t first = channels * t / threads, count = channels * (t + 1) / threads - first;
+        LayerSlice slice = {layer, 0, 0, nullptr};
+        slice.layer.out_channels = static_cast<uint16_t>(count);
+        switch (layer.type) {
+            case LayerType::Conv1D:
+                slice.layer.kernel += first * layer.in_channels * layer.size;
+                slice.layer.bias += first;
+                slice.output_offset = first * layer.out_samples;
+                break;
+            case LayerType::Dense:
+                slice.layer.kernel += first * input_size(layer);
+                slice.layer.bias += first;
+                slice.output_offset = first;
+                break;
+            default:
+                slice.layer.in_channels = static_cast<uint16_t>(count);
+                slice.input_offset = first * layer.in_samples;
+                slice.output_offset = first * layer.out_samples;
+                break;
+        }
+        if (!kernel->supports(slice.layer))
+            return std::vector<LayerSlice>();
+        if (kernel->prepare)
+            slice.state = kernel->prepare(slice.layer);
+        slices.push_back(slice);
+    }
+    return slices;
+}
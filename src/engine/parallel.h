@@ -0,0 +1,121 @@
+#ifndef ENGINE_PARALLEL_H
+#define ENGINE_PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "kernels.h"
+
+// Busy-wait iterations before a worker parks on the condition variable, about 10-50 us: long enough to bridge the gap
+// between two layers of one inference, short enough not to burn a core between inferences
+static const size_t PARALLEL_SPIN = 20000;
+
+// A layer is split only if every slice keeps at least this many multiply-accumulates (or input values for pooling);
+// below that, waking the workers and waiting for them costs more than it saves
+static const size_t PARALLEL_MIN_WORK = 16384;
+
+// Persistent threads running the slices of one layer at a time, for single-input latency. The calling thread runs
+// slice 0 and the workers the others; between calls the workers spin for PARALLEL_SPIN iterations, then park.
+class WorkerPool {
+public:
+    // `threads` counts the calling thread, 1 means no worker at all
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    size_t threads() const {
+        return workers_.size() + 1;
+    }
+
+    // Calls fn(slice) for every slice in [0, threads()) and returns once all of them returned
+    template<typename F>
+    void run(F &fn) {
+        dispatch([](void *context, size_t slice) { (*static_cast<F *>(context))(slice); }, &fn);
+    }
+
+private:
+    typedef void (*SliceFn)(void *context, size_t slice);
+
+    void dispatch(SliceFn fn, void *context);
+    void work(size_t slice);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> generation_{0}; // Bumped for every dispatch, workers run each generation once
+    std::atomic<size_t> pending_{0};    // Workers still running the current generation
+    std::atomic<bool> stop_{false};
+    SliceFn fn_ = nullptr;
+    void *context_ = nullptr;
+};
+
+// Threads running many small independent tasks, like the windows of concurrent audio streams. Each worker pops the
+// oldest task of its own deque, so the windows of a stream queued on it run in order, and once it is empty steals
+// the oldest task of another worker, so that a worker stuck behind a slow task does not hold back the ones queued
+// after it. Tasks get the index of the worker running them, to use per-worker state (an Interpreter each).
+class StealingPool {
+public:
+    typedef std::function<void(size_t worker)> Task;
+
+    explicit StealingPool(size_t threads);
+    // Runs the tasks still queued, then stops the workers
+    ~StealingPool();
+    StealingPool(const StealingPool &) = delete;
+    StealingPool &operator=(const StealingPool &) = delete;
+
+    size_t threads() const {
+        return workers_.size();
+    }
+
+    // Queues `task` on worker `hint` % threads(), any thread may submit
+    void submit(size_t hint, Task task);
+
+    // Returns once every task submitted so far ran
+    void wait_idle();
+
+    // Tasks run by another worker than the one they were queued on
+    size_t steals() const {
+        return steals_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(size_t worker, Task &task);
+    void work(size_t worker);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_; // Guards the counters below, for parking and wait_idle()
+    std::condition_variable wake_, idle_;
+    size_t queued_ = 0;     // Tasks in the deques
+    size_t unfinished_ = 0; // Tasks submitted and not done yet
+    bool stop_ = false;
+    std::atomic<size_t> steals_{0};
+};
+
+// One share of a layer's output channels, run as a layer of its own: filters for Conv1D, units for Dense, channels
+// for pooling. The offsets locate its input and output within the whole layer's tensors; kernels with a prepare()
+// get their own state for the slice (reordered weights of its filters only, ...).
+struct LayerSlice {
+    Layer layer;
+    size_t input_offset;
+    size_t output_offset;
+    std::shared_ptr<void> state;
+};
+
+// Splits `layer` into one slice per thread. Empty when the layer should stay on one thread: too little work per slice,
+// fewer channels than threads, Flatten, or a kernel that does not support the slices.
+std::vector<LayerSlice> parallel_slices(const Layer &layer, const KernelVariant *kernel, size_t threads);
+
+#endif // ENGINE_PARALLEL_H
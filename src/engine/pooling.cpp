@@ -0,0 +1,211 @@
+#include "pooling.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "kernels.h"
+
+static const size_t POOL_LANES = 8;
+
+#if defined(__SSE2__)
+
+static bool is_power_of_two(size_t value) {
+    return value && (value & (value - 1)) == 0;
+}
+
+bool max_pool1d_simd_supports(const Layer &layer) {
+    return layer.size >= POOL_LANES || ((layer.size == 2 || layer.size == 4) && layer.stride == layer.size);
+}
+
+bool avg_pool1d_simd_supports(const Layer &layer) {
+    return layer.size % POOL_LANES == 0 && is_power_of_two(layer.size);
+}
+
+static inline __m128i load(const number_t *values) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(values));
+}
+
+static inline void store(number_t *values, __m128i vector) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(values), vector);
+}
+
+// Max of each pair of consecutive samples of a and b, in order: the even and odd samples are sign-extended to 32 bits
+// and packed back, which cannot saturate
+static inline __m128i pairwise_max(__m128i a, __m128i b) {
+    const __m128i even = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+    const __m128i odd = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+    return _mm_max_epi16(even, odd);
+}
+
+// Lane i of the result is the max of the 8 lanes of v[i]
+static inline __m128i transpose_max(const __m128i v[POOL_LANES]) {
+    __m128i pairs[4], quads[2];
+    for (size_t i = 0; i < 4; i++)
+        pairs[i] = _mm_max_epi16(_mm_unpacklo_epi16(v[2 * i], v[2 * i + 1]), _mm_unpackhi_epi16(v[2 * i], v[2 * i + 1]));
+    for (size_t i = 0; i < 2; i++)
+        quads[i] = _mm_max_epi16(_mm_unpacklo_epi32(pairs[2 * i], pairs[2 * i + 1]),
+                                 _mm_unpackhi_epi32(pairs[2 * i], pairs[2 * i + 1]));
+    return _mm_max_epi16(_mm_unpacklo_epi64(quads[0], quads[1]), _mm_unpackhi_epi64(quads[0], quads[1]));
+}
+
+// Walks the pooling windows of all channels in output order without a division per window
+class WindowCursor {
+public:
+    WindowCursor(const Layer &layer, const number_t *input)
+        : row_(input), window_(input), in_samples_(layer.in_samples), out_samples_(layer.out_samples),
+          stride_(layer.stride) {}
+
+    // Returns the current window and moves to the next one
+    const number_t *next() {
+        const number_t *window = window_;
+        if (++pos_x_ == out_samples_) {
+            pos_x_ = 0;
+            row_ += in_samples_;
+            window_ = row_;
+        } else {
+            window_ += stride_;
+        }
+        return window;
+    }
+
+private:
+    const number_t *row_;
+    const number_t *window_;
+    size_t pos_x_ = 0;
+    const size_t in_samples_, out_samples_, stride_;
+};
+
+// Lane i of the result is the sum of the 4 lanes of v[i], for 4 vectors
+static inline __m128i transpose_sum(const __m128i v[4]) {
+    const __m128i low = _mm_add_epi32(_mm_unpacklo_epi32(v[0], v[1]), _mm_unpackhi_epi32(v[0], v[1]));
+    const __m128i high = _mm_add_epi32(_mm_unpacklo_epi32(v[2], v[3]), _mm_unpackhi_epi32(v[2], v[3]));
+    return _mm_add_epi32(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+}
+
+// Same result as max_pool1d_generic for one output
+static inline number_t max_window(const number_t *window, size_t size, bool relu) {
+    number_t max = relu ? 0 : window[0];
+    for (size_t x = 0; x < size; x++)
+        max = std::max(max, window[x]);
+    return max;
+}
+
+// Pools of 2 or 4 with stride == size: eight outputs read 8 * size consecutive samples
+template<size_t Size>
+static void max_pool1d_deinterleaved(const Layer &layer, const number_t *input, number_t *output) {
+    const size_t channels = layer.in_channels, in_samples = layer.in_samples, out_samples = layer.out_samples;
+    const bool relu = layer.activation == Activation::ReLU;
+    const __m128i floor = relu ? _mm_setzero_si128() : _mm_set1_epi16(NUMBER_MIN);
+
+    for (size_t k = 0; k < channels; k++) {
+        const number_t *in = input + k * in_samples;
+        number_t *out = output + k * out_samples;
+        size_t pos_x = 0;
+        for (; pos_x + POOL_LANES <= out_samples; pos_x += POOL_LANES) {
+            const number_t *window = in + pos_x * Size;
+            __m128i max = pairwise_max(load(window), load(window + 8));
+            if (Size == 4)
+                max = pairwise_max(max, pairwise_max(load(window + 16), load(window + 24)));
+            store(out + pos_x, _mm_max_epi16(max, floor));
+        }
+        for (; pos_x < out_samples; pos_x++)
+            out[pos_x] = max_window(in + pos_x * Size, Size, relu);
+    }
+}
+
+// Pools of 8 samples or more, any stride: outputs are taken 8 at a time across channel boundaries
+static void max_pool1d_windows(const Layer &layer, const number_t *input, number_t *output) {
+    const size_t size = layer.size, outputs = output_size(layer);
+    const bool relu = layer.activation == Activation::ReLU;
+    const __m128i floor = relu ? _mm_setzero_si128() : _mm_set1_epi16(NUMBER_MIN);
+    WindowCursor windows_of(layer, input);
+
+    size_t o = 0;
+    for (; o + POOL_LANES <= outputs; o += POOL_LANES) {
+        __m128i windows[POOL_LANES];
+        for (size_t i = 0; i < POOL_LANES; i++) {
+            const number_t *window = windows_of.next();
+            __m128i max = load(window + size - 8);
+            for (size_t x = 0; x + 8 < size; x += 8)
+                max = _mm_max_epi16(max, load(window + x));
+            windows[i] = max;
+        }
+        store(output + o, _mm_max_epi16(transpose_max(windows), floor));
+    }
+    for (; o < outputs; o++)
+        output[o] = max_window(windows_of.next(), size, relu);
+}
+
+void max_pool1d_simd(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    if (layer.size >= POOL_LANES)
+        max_pool1d_windows(layer, input, output);
+    else if (layer.size == 4)
+        max_pool1d_deinterleaved<4>(layer, input, output);
+    else
+        max_pool1d_deinterleaved<2>(layer, input, output);
+}
+
+// Truncating division by the pool size like the generated average_pooling1d: adding size - 1 to negative sums before
+// the arithmetic shift rounds them toward zero
+void avg_pool1d_simd(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    const size_t size = layer.size, outputs = output_size(layer);
+    const bool relu = layer.activation == Activation::ReLU;
+    int shift = 0;
+    while ((size_t(1) << shift) < size)
+        shift++;
+    const __m128i ones = _mm_set1_epi16(1), round = _mm_set1_epi32(static_cast<int>(size) - 1);
+    WindowCursor windows_of(layer, input);
+
+    auto average = [&](__m128i sums) {
+        if (relu)
+            sums = _mm_andnot_si128(_mm_srai_epi32(sums, 31), sums);
+        sums = _mm_add_epi32(sums, _mm_and_si128(_mm_srai_epi32(sums, 31), round));
+        return _mm_srai_epi32(sums, shift);
+    };
+
+    size_t o = 0;
+    for (; o + POOL_LANES <= outputs; o += POOL_LANES) {
+        __m128i sums[POOL_LANES];
+        for (size_t i = 0; i < POOL_LANES; i++) {
+            const number_t *window = windows_of.next();
+            __m128i sum = _mm_madd_epi16(load(window), ones);
+            for (size_t x = 8; x < size; x += 8)
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(load(window + x), ones));
+            sums[i] = sum;
+        }
+        // packs saturates like clamp_to_number_t
+        store(output + o, _mm_packs_epi32(average(transpose_sum(sums)), average(transpose_sum(sums + 4))));
+    }
+    for (; o < outputs; o++) {
+        const number_t *window = windows_of.next();
+        long_number_t sum = 0;
+        for (size_t x = 0; x < size; x++)
+            sum += window[x];
+        if (relu && sum < 0)
+            sum = 0;
+        output[o] = clamp_to_number_t(sum / static_cast<long_number_t>(size));
+    }
+}
+
+#else
+
+bool max_pool1d_simd_supports(const Layer &) {
+    return false;
+}
+
+bool avg_pool1d_simd_supports(const Layer &) {
+    return false;
+}
+
+void max_pool1d_simd(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state) {
+    max_pool1d_generic(layer, input, output, scratch, state);
+}
+
+void avg_pool1d_simd(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state) {
+    avg_pool1d_generic(layer, input, output, scratch, state);
+}
+
+#endif
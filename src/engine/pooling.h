@@ -0,0 +1,19 @@
+#ifndef ENGINE_POOLING_H
+#define ENGINE_POOLING_H
+
+#include "layer.h"
+
+// SSE2 pooling, bit-exact with the generic kernels. Eight outputs are computed at a time:
+// - max pooling with a pool of 2 or 4 (stride equal to the pool) deinterleaves even and odd samples and takes their
+//   vertical max, once per halving of the pool;
+// - pools of 8 or more samples reduce each window to one vector with overlapping loads (max is idempotent), then the
+//   eight window vectors to one with a transposing unpack/max tree;
+// - average pooling over a multiple of 8 samples sums each window with pmaddwd, reduces the sums the same way and
+//   divides with a shift rounding toward zero, so the pool must also be a power of two.
+// Without SSE2 the variant supports no layer and the generic kernels are used.
+bool max_pool1d_simd_supports(const Layer &layer);
+bool avg_pool1d_simd_supports(const Layer &layer);
+void max_pool1d_simd(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void avg_pool1d_simd(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+
+#endif // ENGINE_POOLING_H
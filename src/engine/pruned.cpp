@@ -0,0 +1,198 @@
+#include "pruned.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "kernels.h"
+
+BlockSparseWeights compress_blocks(const Layer &layer) {
+    BlockSparseWeights weights;
+
+    if (layer.type == LayerType::Conv1D) {
+        const size_t filters = layer.out_channels, in_channels = layer.in_channels, size = layer.size;
+        for (size_t x = 0; x < size; x++) {
+            bool used = false;
+            for (size_t row = 0; row < filters * in_channels && !used; row++)
+                used = layer.kernel[row * size + x] != 0;
+            if (used)
+                weights.taps.push_back(x);
+        }
+        weights.block_size = weights.taps.size();
+
+        for (size_t k = 0; k < filters; k++) {
+            for (size_t z = 0; z < in_channels; z++) {
+                const number_t *w = layer.kernel + (k * in_channels + z) * size;
+                if (std::none_of(w, w + size, [](number_t v) { return v != 0; }))
+                    continue;
+                weights.blocks.push_back(z);
+                for (uint16_t x : weights.taps)
+                    weights.values.push_back(w[x]);
+            }
+            weights.row_end.push_back(weights.blocks.size());
+        }
+    } else if (layer.type == LayerType::Dense) {
+        const size_t inputs = input_size(layer);
+        weights.block_size = DENSE_BLOCK;
+        for (size_t k = 0; k < layer.out_channels; k++) {
+            const number_t *w = layer.kernel + k * inputs;
+            for (size_t start = 0; start < inputs; start += DENSE_BLOCK) {
+                const size_t end = std::min(inputs, start + DENSE_BLOCK);
+                if (std::none_of(w + start, w + end, [](number_t v) { return v != 0; }))
+                    continue;
+                weights.blocks.push_back(start);
+                for (size_t i = start; i < start + DENSE_BLOCK; i++)
+                    weights.values.push_back(i < end ? w[i] : 0);
+            }
+            weights.row_end.push_back(weights.blocks.size());
+        }
+    }
+    return weights;
+}
+
+// Zeroes the `fraction` of structures with the smallest norm, zero(i) clearing structure i
+template<typename Zero>
+static void zero_smallest(const std::vector<long> &norms, float fraction, Zero zero) {
+    const size_t count = static_cast<size_t>(fraction * norms.size());
+    std::vector<size_t> order(norms.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return norms[a] < norms[b]; });
+    for (size_t i = 0; i < count; i++)
+        zero(order[i]);
+}
+
+Graph prune_graph(const Graph &graph, const PruningOptions &options) {
+    Graph pruned = graph.owned_copy();
+
+    for (size_t l = 0; l < pruned.layers.size(); l++) {
+        const Layer &layer = pruned.layers[l];
+        number_t *kernel = pruned.mutable_kernel(l);
+
+        if (layer.type == LayerType::Conv1D) {
+            const size_t filters = layer.out_channels, in_channels = layer.in_channels, size = layer.size;
+            const size_t rows = filters * in_channels;
+
+            std::vector<long> norms(filters, 0);
+            for (size_t i = 0; i < kernel_size(layer); i++)
+                norms[i / (in_channels * size)] += std::abs(kernel[i]);
+            zero_smallest(norms, options.filters, [&](size_t k) {
+                std::fill(kernel + k * in_channels * size, kernel + (k + 1) * in_channels * size, 0);
+            });
+
+            norms.assign(size, 0);
+            for (size_t i = 0; i < kernel_size(layer); i++)
+                norms[i % size] += std::abs(kernel[i]);
+            zero_smallest(norms, options.taps, [&](size_t x) {
+                for (size_t row = 0; row < rows; row++)
+                    kernel[row * size + x] = 0;
+            });
+
+            if (in_channels > 1) {
+                norms.assign(rows, 0);
+                for (size_t i = 0; i < kernel_size(layer); i++)
+                    norms[i / size] += std::abs(kernel[i]);
+                zero_smallest(norms, options.blocks, [&](size_t row) {
+                    std::fill(kernel + row * size, kernel + (row + 1) * size, 0);
+                });
+            }
+        } else if (layer.type == LayerType::Dense) {
+            const size_t inputs = input_size(layer);
+            const size_t blocks_per_unit = (inputs + DENSE_BLOCK - 1) / DENSE_BLOCK;
+
+            std::vector<long> norms(layer.out_channels * blocks_per_unit, 0);
+            for (size_t i = 0; i < kernel_size(layer); i++)
+                norms[i / inputs * blocks_per_unit + i % inputs / DENSE_BLOCK] += std::abs(kernel[i]);
+            zero_smallest(norms, options.blocks, [&](size_t block) {
+                number_t *w = kernel + block / blocks_per_unit * inputs;
+                const size_t start = block % blocks_per_unit * DENSE_BLOCK;
+                std::fill(w + start, w + std::min(inputs, start + DENSE_BLOCK), 0);
+            });
+        }
+    }
+    return pruned;
+}
+
+size_t pruned_macs(const Layer &layer, const BlockSparseWeights &weights) {
+    if (layer.type == LayerType::Conv1D)
+        return weights.kept_blocks() * weights.block_size * layer.out_samples;
+
+    size_t total = 0;
+    for (uint16_t start : weights.blocks)
+        total += std::min(DENSE_BLOCK, input_size(layer) - start);
+    return total;
+}
+
+size_t conv1d_pruned_scratch(const Layer &layer) {
+    return layer.out_samples * sizeof(long_number_t);
+}
+
+std::shared_ptr<void> pruned_prepare(const Layer &layer) {
+    return std::make_shared<BlockSparseWeights>(compress_blocks(layer));
+}
+
+// Same accumulation scheme as conv1d_generic, restricted to the kept blocks and taps. Blocks whose three taps all
+// survived take the fused single-pass loop like the generic kernel does for size 3.
+void conv1d_pruned(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state) {
+    const BlockSparseWeights &weights = *static_cast<const BlockSparseWeights *>(state);
+    long_number_t *acc = static_cast<long_number_t *>(scratch);
+    const size_t in_samples = layer.in_samples, out_samples = layer.out_samples, stride = layer.stride;
+    const size_t block_size = weights.block_size;
+    const bool fused = stride == 1 && block_size == 3 && weights.taps[0] == 0 && weights.taps[2] == 2;
+    const Activation activation = layer.activation;
+
+    size_t block = 0;
+    for (size_t k = 0; k < layer.out_channels; k++) {
+        const long_number_t bias = layer.bias[k];
+        number_t *out = output + k * out_samples;
+        const size_t row_end = weights.row_end[k];
+
+        // Pruned filter: every position gets the activated bias
+        if (block == row_end) {
+            std::fill(out, out + out_samples, activate(activation, scale_number_t(0) + bias));
+            continue;
+        }
+
+        std::fill(acc, acc + out_samples, 0);
+        for (; block < row_end; block++) {
+            const number_t *in = input + weights.blocks[block] * in_samples;
+            const number_t *w = weights.values.data() + block * block_size;
+            if (fused) {
+                for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+                    acc[pos_x] += in[pos_x] * w[0] + in[pos_x + 1] * w[1] + in[pos_x + 2] * w[2];
+                continue;
+            }
+            for (size_t t = 0; t < block_size; t++) {
+                const number_t *tap = in + weights.taps[t];
+                const number_t wx = w[t];
+                if (stride == 1) {
+                    for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+                        acc[pos_x] += tap[pos_x] * wx;
+                } else {
+                    for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+                        acc[pos_x] += tap[pos_x * stride] * wx;
+                }
+            }
+        }
+
+        for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+            out[pos_x] = activate(activation, scale_number_t(acc[pos_x]) + bias);
+    }
+}
+
+void dense_pruned(const Layer &layer, const number_t *input, number_t *output, void *, void *state) {
+    const BlockSparseWeights &weights = *static_cast<const BlockSparseWeights *>(state);
+    const size_t inputs = input_size(layer);
+
+    size_t block = 0;
+    for (size_t k = 0; k < layer.out_channels; k++) {
+        long_number_t acc = 0;
+        for (; block < weights.row_end[k]; block++) {
+            const size_t start = weights.blocks[block];
+            const size_t count = std::min(DENSE_BLOCK, inputs - start);
+            const number_t *w = weights.values.data() + block * DENSE_BLOCK;
+            for (size_t i = 0; i < count; i++)
+                acc += w[i] * input[start + i];
+        }
+        output[k] = activate(layer.activation, scale_number_t(acc) + layer.bias[k]);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef ENGINE_PRUNED_H
+#define ENGINE_PRUNED_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "graph.h"
+
+// Dense weights are grouped by DENSE_BLOCK consecutive inputs of one unit
+static const size_t DENSE_BLOCK = 8;
+
+// Block-sparse copy of the weights of a structurally pruned Conv1D or Dense layer. A Conv1D block is the `size` taps
+// linking one filter to one input channel, a Dense block DENSE_BLOCK inputs of one unit; only blocks with a nonzero
+// weight are stored. Conv1D taps that are zero in every block are dropped from all of them, and filters without
+// blocks reduce to their activated bias.
+struct BlockSparseWeights {
+    size_t block_size = 0;          // Stored values per block (active taps for Conv1D, DENSE_BLOCK for Dense)
+    std::vector<uint16_t> taps;     // Conv1D only, tap offsets kept in every block
+    std::vector<uint32_t> row_end;  // End of each filter/unit's blocks in `blocks`
+    std::vector<uint16_t> blocks;   // Input channel (Conv1D) or first input (Dense) of each kept block
+    std::vector<number_t> values;   // [kept blocks][block_size]
+
+    size_t kept_blocks() const {
+        return blocks.size();
+    }
+
+    // Size of the compressed layout: values, block indices and row ends
+    size_t bytes() const {
+        return values.size() * sizeof(number_t) + blocks.size() * sizeof(uint16_t) + row_end.size() * sizeof(uint32_t);
+    }
+};
+
+BlockSparseWeights compress_blocks(const Layer &layer);
+
+// Fractions of each structure zeroed by prune_graph(), those with the smallest L1 norm first
+struct PruningOptions {
+    float filters = 0; // Whole Conv1D filters
+    float taps = 0;    // Conv1D kernel taps, across all filters and input channels
+    float blocks = 0;  // Blocks (see BlockSparseWeights) of multi-channel Conv1D and of Dense layers
+};
+
+// Copy of the graph with structurally pruned weights; biases are kept
+Graph prune_graph(const Graph &graph, const PruningOptions &options);
+
+// Multiply-accumulates left once pruned blocks, taps and filters are skipped
+size_t pruned_macs(const Layer &layer, const BlockSparseWeights &weights);
+
+size_t conv1d_pruned_scratch(const Layer &layer);
+std::shared_ptr<void> pruned_prepare(const Layer &layer);
+void conv1d_pruned(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void dense_pruned(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+
+#endif // ENGINE_PRUNED_H
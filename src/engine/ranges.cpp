@@ -0,0 +1,182 @@
+#include "ranges.h"
+
+#include <algorithm>
+
+#include "kernels.h"
+
+int ValueRange::bits() const {
+    int bits = 1;
+    while (min < -(int64_t(1) << (bits - 1)) || max > (int64_t(1) << (bits - 1)) - 1)
+        bits++;
+    return bits;
+}
+
+ValueRange format_range() {
+    ValueRange range;
+    range.min = NUMBER_MIN;
+    range.max = NUMBER_MAX;
+    return range;
+}
+
+int LayerRanges::accumulator_bits() const {
+    int bits = 1;
+    for (const ChannelRange &channel : channels)
+        bits = std::max(bits, channel.partial.bits());
+    return bits;
+}
+
+static ValueRange make_range(int64_t min, int64_t max) {
+    ValueRange range;
+    range.min = min;
+    range.max = max;
+    return range;
+}
+
+static int64_t saturate_value(int64_t value) {
+    return std::min<int64_t>(std::max<int64_t>(value, NUMBER_MIN), NUMBER_MAX);
+}
+
+// What the kernels write for a full sum `acc` of products: arithmetic shift like scale_number_t(), bias, activation
+static int64_t requantized(int64_t acc, int64_t bias, Activation activation) {
+    int64_t value = (acc >> FIXED_POINT) + bias;
+    if (activation == Activation::ReLU)
+        value = std::max<int64_t>(value, 0);
+    return saturate_value(value);
+}
+
+// Partial and full sum bounds of sum(weights[i] * x[i]), x[i] lying in inputs[channel(i)]
+template<typename Channel>
+static ChannelRange mac_range(const number_t *weights, size_t count, Channel channel,
+                              const std::vector<ValueRange> &inputs, int64_t bias, Activation activation) {
+    int64_t negative = 0, positive = 0, sum_min = 0, sum_max = 0;
+    for (size_t i = 0; i < count; i++) {
+        const ValueRange &x = inputs[channel(i)];
+        const int64_t a = weights[i] * x.min, b = weights[i] * x.max;
+        const int64_t term_min = std::min(a, b), term_max = std::max(a, b);
+        negative += std::min<int64_t>(term_min, 0);
+        positive += std::max<int64_t>(term_max, 0);
+        sum_min += term_min;
+        sum_max += term_max;
+    }
+    ChannelRange range;
+    range.partial = make_range(negative, positive);
+    range.output = make_range(requantized(sum_min, bias, activation), requantized(sum_max, bias, activation));
+    return range;
+}
+
+LayerRanges analyze_layer(const Layer &layer, const std::vector<ValueRange> &input) {
+    LayerRanges ranges;
+    ranges.inputs = input;
+    ranges.channels.resize(layer.out_channels);
+    const bool relu = layer.activation == Activation::ReLU;
+
+    switch (layer.type) {
+        case LayerType::Conv1D: {
+            const size_t size = layer.size, filter_size = layer.in_channels * size;
+            for (size_t k = 0; k < layer.out_channels; k++)
+                ranges.channels[k] = mac_range(layer.kernel + k * filter_size, filter_size,
+                                               [&](size_t i) { return i / size; }, input, layer.bias[k], layer.activation);
+            break;
+        }
+        case LayerType::Dense: {
+            const size_t inputs = input_size(layer), samples = layer.in_samples;
+            for (size_t k = 0; k < layer.out_channels; k++)
+                ranges.channels[k] = mac_range(layer.kernel + k * inputs, inputs,
+                                               [&](size_t i) { return i / samples; }, input, layer.bias[k], layer.activation);
+            break;
+        }
+        case LayerType::MaxPool1D:
+            // ReLU pooling starts from 0 like the generated code
+            for (size_t k = 0; k < layer.out_channels; k++) {
+                const ValueRange &x = input[k];
+                ranges.channels[k].partial = x;
+                ranges.channels[k].output = relu ? make_range(std::max<int64_t>(x.min, 0), std::max<int64_t>(x.max, 0)) : x;
+            }
+            break;
+        case LayerType::AvgPool1D:
+            for (size_t k = 0; k < layer.out_channels; k++) {
+                const ValueRange &x = input[k];
+                const int64_t size = layer.size;
+                ranges.channels[k].partial = make_range(std::min<int64_t>(x.min * size, 0), std::max<int64_t>(x.max * size, 0));
+                const int64_t low = relu ? std::max<int64_t>(x.min * size, 0) : x.min * size;
+                const int64_t high = relu ? std::max<int64_t>(x.max * size, 0) : x.max * size;
+                ranges.channels[k].output = make_range(saturate_value(low / size), saturate_value(high / size));
+            }
+            break;
+        case LayerType::Flatten:
+            for (size_t k = 0; k < layer.out_channels; k++) {
+                ranges.channels[k].partial = input[k / layer.in_samples];
+                ranges.channels[k].output = input[k / layer.in_samples];
+            }
+            break;
+    }
+    return ranges;
+}
+
+std::vector<LayerRanges> analyze_ranges(const Graph &graph, const std::vector<ValueRange> &input) {
+    std::vector<LayerRanges> ranges;
+    std::vector<ValueRange> channels = input;
+    for (const Layer &layer : graph.layers) {
+        ranges.push_back(analyze_layer(layer, channels));
+        channels.clear();
+        for (const ChannelRange &channel : ranges.back().channels)
+            channels.push_back(channel.output);
+    }
+    return ranges;
+}
+
+bool narrow_supports(const Layer &layer) {
+    const std::vector<ValueRange> input(layer.in_channels, format_range());
+    return analyze_layer(layer, input).accumulator_bits() <= NARROW_ACCUMULATOR_BITS;
+}
+
+size_t conv1d_narrow_scratch(const Layer &layer) {
+    return layer.out_samples * sizeof(number_t);
+}
+
+// conv1d_generic with number_t accumulators: products and sums wrap to 16 bits, which pmullw/paddw compute 8 lanes at
+// a time, and narrow_supports() guarantees that nothing actually wraps
+void conv1d_narrow(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *) {
+    number_t *acc = static_cast<number_t *>(scratch);
+    const size_t in_channels = layer.in_channels, in_samples = layer.in_samples;
+    const size_t filters = layer.out_channels, out_samples = layer.out_samples;
+    const size_t size = layer.size, stride = layer.stride;
+    const Activation activation = layer.activation;
+
+    for (size_t k = 0; k < filters; k++) {
+        std::fill(acc, acc + out_samples, 0);
+        const number_t *filter = layer.kernel + k * in_channels * size;
+        for (size_t z = 0; z < in_channels; z++) {
+            const number_t *in = input + z * in_samples;
+            const number_t *w = filter + z * size;
+            for (size_t x = 0; x < size; x++) {
+                const number_t wx = w[x];
+                if (stride == 1) {
+                    for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+                        acc[pos_x] = static_cast<number_t>(acc[pos_x] + in[pos_x + x] * wx);
+                } else {
+                    for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+                        acc[pos_x] = static_cast<number_t>(acc[pos_x] + in[pos_x * stride + x] * wx);
+                }
+            }
+        }
+
+        const long_number_t bias = layer.bias[k];
+        number_t *out = output + k * out_samples;
+        for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+            out[pos_x] = activate(activation, scale_number_t(acc[pos_x]) + bias);
+    }
+}
+
+void dense_narrow(const Layer &layer, const number_t *input, number_t *output, void *, void *) {
+    const size_t inputs = input_size(layer), units = layer.out_channels;
+    const Activation activation = layer.activation;
+
+    for (size_t k = 0; k < units; k++) {
+        const number_t *weights = layer.kernel + k * inputs;
+        number_t acc = 0;
+        for (size_t z = 0; z < inputs; z++)
+            acc = static_cast<number_t>(acc + weights[z] * input[z]);
+        output[k] = activate(activation, scale_number_t(acc) + layer.bias[k]);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef ENGINE_RANGES_H
+#define ENGINE_RANGES_H
+
+#include <cstdint>
+#include <vector>
+
+#include "graph.h"
+
+// Inclusive range of integer values, in raw fixed-point units
+struct ValueRange {
+    int64_t min = 0;
+    int64_t max = 0;
+
+    // Smallest two's complement width holding every value of the range
+    int bits() const;
+};
+
+// The whole number_t range: all a layer can assume about its input without knowing the previous layers
+ValueRange format_range();
+
+// Worst-case ranges of one output channel (a filter or unit for Conv1D and Dense)
+struct ChannelRange {
+    ValueRange partial; // Every partial sum of the accumulator, whatever the order of the additions
+    ValueRange output;  // Values written after scaling, bias, activation and saturation
+};
+
+// Worst-case ranges of one layer given the ranges of its input channels
+struct LayerRanges {
+    std::vector<ValueRange> inputs;     // Per input channel
+    std::vector<ChannelRange> channels; // Per output channel
+
+    // Accumulator width the layer needs: every partial sum of every channel fits it
+    int accumulator_bits() const;
+};
+
+// Interval analysis of the graph from per-channel input ranges (the model input channels), using the actual weights
+// and biases. Bounds are sound for any input within the given ranges:
+// - a product w * x lies between w * min and w * max, so partial sums lie between the sum of the negative product
+//   bounds and the sum of the positive ones, whichever terms are already added;
+// - scale_number_t() (arithmetic shift), the bias, ReLU and clamp_to_number_t() are monotonic, so the output range is
+//   the image of the full-sum range;
+// - max pooling and truncating average pooling stay within the range of their inputs.
+// Weightless layers report the range of their own accumulation (avg pooling sums, or the inputs themselves).
+std::vector<LayerRanges> analyze_ranges(const Graph &graph, const std::vector<ValueRange> &input);
+
+// Same for a single layer whose input channels all lie in `input`
+LayerRanges analyze_layer(const Layer &layer, const std::vector<ValueRange> &input);
+
+// Accumulator width of Conv1D and Dense variants running on int16 lanes ("narrow")
+static const int NARROW_ACCUMULATOR_BITS = 16;
+
+// The narrow variants accumulate in number_t: they only support layers whose partial sums provably fit it for any
+// input of the number_t format, and then match the generic kernels bit for bit
+bool narrow_supports(const Layer &layer);
+size_t conv1d_narrow_scratch(const Layer &layer);
+void conv1d_narrow(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+void dense_narrow(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+
+#endif // ENGINE_RANGES_H
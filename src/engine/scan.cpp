@@ -0,0 +1,73 @@
+#include "scan.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+static bool is_sliding(const Layer &layer) {
+    return layer.type == LayerType::Conv1D || layer.type == LayerType::MaxPool1D || layer.type == LayerType::AvgPool1D;
+}
+
+Scanner::Scanner(const Graph &graph, size_t hop) : hop_(hop), window_(graph.input_size()) {
+    if (graph.input_channels != 1)
+        throw std::runtime_error("scanning needs a single-channel model input");
+    if (hop == 0)
+        throw std::runtime_error("the hop must be at least one sample");
+
+    // Deepest trunk the hop allows, keeping at least one layer in the head
+    size_t trunk = 0;
+    stride_ = 1;
+    for (size_t l = 0, stride = 1; l + 1 < graph.layers.size() && is_sliding(graph.layers[l]); l++) {
+        stride *= graph.layers[l].stride;
+        if (hop % stride == 0) {
+            trunk = l + 1;
+            stride_ = stride;
+        }
+    }
+    segment_windows_ = trunk == 0 || window_ > SCAN_MAX_SEGMENT ? 1 : (SCAN_MAX_SEGMENT - window_) / hop + 1;
+
+    Graph head = graph;
+    head.layers.erase(head.layers.begin(), head.layers.begin() + trunk);
+    if (trunk > 0) {
+        head.input_channels = graph.layers[trunk - 1].out_channels;
+        head.input_samples = graph.layers[trunk - 1].out_samples;
+        window_features_ = head.input_samples;
+
+        // Same layers over a whole segment
+        Graph segment = graph;
+        segment.layers.resize(trunk);
+        segment.input_samples = static_cast<uint16_t>(segment_samples());
+        uint16_t samples = segment.input_samples;
+        for (Layer &layer : segment.layers) {
+            layer.in_samples = samples;
+            infer_output_shape(layer);
+            samples = layer.out_samples;
+        }
+        trunk_.reset(new Interpreter(segment));
+        features_.resize(segment.output_size());
+        input_.resize(head.input_size());
+    } else {
+        window_features_ = window_;
+    }
+    head_.reset(new Interpreter(head));
+}
+
+void Scanner::scan(const number_t *segment, size_t count, size_t *labels, number_t *logits) {
+    if (count > segment_windows_)
+        throw std::runtime_error("a segment holds at most " + std::to_string(segment_windows_) + " windows");
+    if (!trunk_) {
+        for (size_t w = 0; w < count; w++)
+            labels[w] = head_->classify(segment + w * hop_, logits + w * outputs()).label;
+        return;
+    }
+
+    trunk_->run(segment, features_.data());
+    const size_t channels = head_->graph().input_channels, length = trunk_->graph().output_size() / channels;
+    for (size_t w = 0; w < count; w++) {
+        // Window w starts hop / stride trunk samples after the previous one in every channel
+        const size_t offset = w * (hop_ / stride_);
+        for (size_t c = 0; c < channels; c++)
+            std::copy_n(&features_[c * length + offset], window_features_, &input_[c * window_features_]);
+        labels[w] = head_->classify(input_.data(), logits + w * outputs()).label;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef ENGINE_SCAN_H
+#define ENGINE_SCAN_H
+
+#include <memory>
+#include <vector>
+
+#include "interpreter.h"
+
+// Longest segment the trunk runs over, layer shapes holding 16-bit sample counts
+static const size_t SCAN_MAX_SEGMENT = 65535;
+
+// Classifies the windows of a long signal that start every `hop` samples, a segment of overlapping windows at a time.
+// Leading convolution and pooling layers commute with shifts by a multiple of their cumulative stride, so the deepest
+// such layers whose cumulative stride divides the hop (the trunk: for the GSC model, up to the second convolution for a
+// hop of 80, up to the last max pooling for 1280, nothing for a hop of 1) run once over the whole segment and each
+// window only runs the other layers (the head) on its slice of the trunk output, bit-exact with classifying the windows
+// one by one. Consecutive segments overlap by window - hop samples, the input of the windows they share no trunk output
+// for, and are independent of each other so that they can run on different threads, one Scanner each.
+class Scanner {
+public:
+    Scanner(const Graph &graph, size_t hop);
+    Scanner(const Scanner &) = delete;
+    Scanner &operator=(const Scanner &) = delete;
+
+    size_t hop() const {
+        return hop_;
+    }
+
+    // Input samples of one window
+    size_t window() const {
+        return window_;
+    }
+
+    size_t outputs() const {
+        return head_->graph().output_size();
+    }
+
+    // Layers run once per segment, 0 when the hop is not a multiple of the first layer's stride
+    size_t trunk_layers() const {
+        return trunk_ ? trunk_->graph().layers.size() : 0;
+    }
+
+    // Windows per segment and the input samples they span
+    size_t segment_windows() const {
+        return segment_windows_;
+    }
+
+    size_t segment_samples() const {
+        return window_ + (segment_windows_ - 1) * hop_;
+    }
+
+    // Windows of a signal of `samples` samples: those that fit in it, or one zero padded window for a shorter signal
+    size_t windows(size_t samples) const {
+        return samples < window_ ? 1 : (samples - window_) / hop_ + 1;
+    }
+
+    // Classifies the first `count` (up to segment_windows()) windows of `segment`, segment_samples() samples zero
+    // padded past the signal, into count labels and count rows of outputs() logits
+    void scan(const number_t *segment, size_t count, size_t *labels, number_t *logits);
+
+private:
+    size_t hop_, window_, segment_windows_;
+    size_t stride_;           // Input samples per trunk output sample
+    size_t window_features_;  // Trunk output samples of one window
+    std::unique_ptr<Interpreter> trunk_, head_;
+    std::vector<number_t> features_, input_;
+};
+
+#endif // ENGINE_SCAN_H
@@ -0,0 +1,96 @@
+#include "sparse.h"
+
+#include <algorithm>
+
+#include "kernels.h"
+
+static size_t align16(size_t bytes) {
+    return (bytes + 15) & ~static_cast<size_t>(15);
+}
+
+bool conv1d_sparse_supports(const Layer &layer) {
+    return layer.stride == 1;
+}
+
+// Scratch layout: position-major accumulators [out_samples][filters], then the compressed input, nonzero
+// positions (uint16_t) and values of all channels back to back, then the end of each channel's list.
+// The dense fallback only uses the head of the accumulator area.
+size_t conv1d_sparse_scratch(const Layer &layer) {
+    return align16(output_size(layer) * sizeof(long_number_t)) + align16(input_size(layer) * sizeof(uint16_t)) +
+           align16(input_size(layer) * sizeof(number_t)) + layer.in_channels * sizeof(uint32_t);
+}
+
+std::shared_ptr<void> conv1d_sparse_prepare(const Layer &layer) {
+    auto state = std::make_shared<SparseConvState>();
+    const size_t filters = layer.out_channels, in_channels = layer.in_channels, size = layer.size;
+    state->max_density = std::min(SPARSE_MAX_DENSITY, filters / SPARSE_BREAK_EVEN_FILTERS);
+    state->weights.resize(kernel_size(layer));
+    for (size_t k = 0; k < filters; k++)
+        for (size_t z = 0; z < in_channels; z++)
+            for (size_t x = 0; x < size; x++)
+                state->weights[(z * size + x) * filters + k] = layer.kernel[(k * in_channels + z) * size + x];
+    return state;
+}
+
+void conv1d_sparse(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state) {
+    SparseConvState &sparse = *static_cast<SparseConvState *>(state);
+    const size_t in_channels = layer.in_channels, in_samples = layer.in_samples;
+    const size_t filters = layer.out_channels, out_samples = layer.out_samples, size = layer.size;
+
+    char *bytes = static_cast<char *>(scratch);
+    long_number_t *acc = reinterpret_cast<long_number_t *>(bytes);
+    bytes += align16(output_size(layer) * sizeof(long_number_t));
+    uint16_t *positions = reinterpret_cast<uint16_t *>(bytes);
+    bytes += align16(input_size(layer) * sizeof(uint16_t));
+    number_t *values = reinterpret_cast<number_t *>(bytes);
+    bytes += align16(input_size(layer) * sizeof(number_t));
+    uint32_t *channel_end = reinterpret_cast<uint32_t *>(bytes);
+
+    // Compress the nonzero activations of every channel
+    size_t nonzeros = 0;
+    for (size_t z = 0; z < in_channels; z++) {
+        const number_t *in = input + z * in_samples;
+        for (size_t i = 0; i < in_samples; i++) {
+            positions[nonzeros] = i;
+            values[nonzeros] = in[i];
+            nonzeros += in[i] != 0;
+        }
+        channel_end[z] = nonzeros;
+    }
+
+    sparse.stats.calls++;
+    sparse.stats.values += input_size(layer);
+    sparse.stats.nonzeros += nonzeros;
+    if (nonzeros > sparse.max_density * input_size(layer)) {
+        conv1d_generic(layer, input, output, scratch, nullptr);
+        return;
+    }
+    sparse.stats.sparse_calls++;
+
+    // Input sample i contributes through tap x to output position i - x, for all filters at once
+    std::fill(acc, acc + out_samples * filters, 0);
+    size_t n = 0;
+    for (size_t z = 0; z < in_channels; z++) {
+        const number_t *channel_weights = sparse.weights.data() + z * size * filters;
+        for (; n < channel_end[z]; n++) {
+            const size_t i = positions[n];
+            const long_number_t value = values[n];
+            const size_t first_x = i >= out_samples ? i - out_samples + 1 : 0;
+            const size_t last_x = std::min(size - 1, i);
+            for (size_t x = first_x; x <= last_x; x++) {
+                long_number_t *row = acc + (i - x) * filters;
+                const number_t *w = channel_weights + x * filters;
+                for (size_t k = 0; k < filters; k++)
+                    row[k] += value * w[k];
+            }
+        }
+    }
+
+    const Activation activation = layer.activation;
+    for (size_t k = 0; k < filters; k++) {
+        const long_number_t bias = layer.bias[k];
+        number_t *out = output + k * out_samples;
+        for (size_t pos_x = 0; pos_x < out_samples; pos_x++)
+            out[pos_x] = activate(activation, scale_number_t(acc[pos_x * filters + k]) + bias);
+    }
+}
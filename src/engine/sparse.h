@@ -0,0 +1,42 @@
+#ifndef ENGINE_SPARSE_H
+#define ENGINE_SPARSE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "layer.h"
+
+// Input activations seen by one layer since its kernel was selected
+struct SparsityStats {
+    uint64_t calls = 0;
+    uint64_t sparse_calls = 0; // Calls that took the zero-skipping path
+    uint64_t values = 0;
+    uint64_t nonzeros = 0;
+
+    double density() const {
+        return values ? static_cast<double>(nonzeros) / values : 0;
+    }
+};
+
+// The zero-skipping path handles all filters of a nonzero input at once, so it pays off up to a density that grows
+// with the filter count: about 0.35 for 16 filters and 0.65 for 32 filters with gsc_bench on x86-64, hence
+// max_density = filters / SPARSE_BREAK_EVEN_FILTERS, capped at SPARSE_MAX_DENSITY
+static const float SPARSE_BREAK_EVEN_FILTERS = 48.0f;
+static const float SPARSE_MAX_DENSITY = 0.75f;
+
+// Zero-skipping Conv1D: the nonzero activations of each input channel are compressed to (index, value) pairs and
+// every pair is scattered to the filters and output positions it contributes to, so zeros produced by ReLU cost
+// nothing. Each call measures the input density first and falls back to the dense kernel above max_density.
+struct SparseConvState {
+    std::vector<number_t> weights; // [in_channels][size][filters], filters innermost for the scatter loop
+    float max_density;
+    SparsityStats stats;
+};
+
+bool conv1d_sparse_supports(const Layer &layer);
+size_t conv1d_sparse_scratch(const Layer &layer);
+std::shared_ptr<void> conv1d_sparse_prepare(const Layer &layer);
+void conv1d_sparse(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+
+#endif // ENGINE_SPARSE_H
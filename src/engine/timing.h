@@ -0,0 +1,84 @@
+#ifndef ENGINE_TIMING_H
+#define ENGINE_TIMING_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+struct TimingStats {
+    double mean_ns = 0;   // Mean time per call over all repeats
+    double stddev_ns = 0; // Standard deviation of the per-call time between repeats
+    double min_ns = 0;    // Best repeat, the least noisy estimate on a busy machine
+    size_t repeats = 0;
+    size_t iterations = 0;
+};
+
+// Times `repeats` batches of `iterations` calls to fn() after one warm-up batch and reports the time per call
+template<typename F>
+TimingStats measure(F &&fn, size_t repeats, size_t iterations) {
+    using clock = std::chrono::steady_clock;
+    TimingStats stats;
+    stats.repeats = repeats;
+    stats.iterations = iterations;
+
+    for (size_t i = 0; i < iterations; i++)
+        fn();
+
+    double sum = 0, sum_sq = 0;
+    stats.min_ns = INFINITY;
+    for (size_t r = 0; r < repeats; r++) {
+        auto start = clock::now();
+        for (size_t i = 0; i < iterations; i++)
+            fn();
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / iterations;
+        sum += ns;
+        sum_sq += ns * ns;
+        stats.min_ns = std::min(stats.min_ns, ns);
+    }
+    stats.mean_ns = sum / repeats;
+    stats.stddev_ns = std::sqrt(std::max(0.0, sum_sq / repeats - stats.mean_ns * stats.mean_ns));
+    return stats;
+}
+
+struct LatencyStats {
+    double p50_ns = 0; // Median time of one call
+    double p99_ns = 0;
+    double max_ns = 0;
+    size_t calls = 0;
+};
+
+// Nearest-rank percentile (p in (0, 1]) of sorted values, 0 for none
+inline double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    const size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+// Times `calls` individual calls to fn() after calls / 10 warm-up calls and reports the distribution of single-call
+// times (nearest-rank percentiles), which is what an interactive user waits for, rather than the throughput
+template<typename F>
+LatencyStats measure_latency(F &&fn, size_t calls) {
+    using clock = std::chrono::steady_clock;
+    for (size_t i = 0; i < calls / 10; i++)
+        fn();
+
+    std::vector<double> times(calls);
+    for (size_t i = 0; i < calls; i++) {
+        auto start = clock::now();
+        fn();
+        times[i] = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    }
+    std::sort(times.begin(), times.end());
+
+    LatencyStats stats;
+    stats.calls = calls;
+    stats.p50_ns = percentile(times, 0.5);
+    stats.p99_ns = percentile(times, 0.99);
+    stats.max_ns = times.empty() ? 0 : times.back();
+    return stats;
+}
+
+#endif // ENGINE_TIMING_H
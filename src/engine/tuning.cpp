@@ -0,0 +1,189 @@
+#include "tuning.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "timing.h"
+
+std::vector<std::vector<number_t>> record_layer_inputs(const Graph &graph, const std::vector<number_t> &inputs) {
+    Interpreter interpreter(graph);
+    const size_t count = inputs.size() / graph.input_size();
+    std::vector<std::vector<number_t>> layer_inputs(graph.layers.size() + 1);
+    layer_inputs[0] = inputs;
+    for (size_t l = 0; l < graph.layers.size(); l++) {
+        const Layer &layer = graph.layers[l];
+        layer_inputs[l + 1].resize(count * output_size(layer));
+        for (size_t i = 0; i < count; i++)
+            interpreter.run_layer(l, &layer_inputs[l][i * input_size(layer)], &layer_inputs[l + 1][i * output_size(layer)]);
+    }
+    return layer_inputs;
+}
+
+KernelMismatch compare_with_generic(Interpreter &interpreter, const std::vector<number_t> &inputs) {
+    const Graph &graph = interpreter.graph();
+    auto layer_inputs = record_layer_inputs(graph, inputs);
+    const size_t count = inputs.size() / graph.input_size();
+
+    // Every layer runs on the generic activations, so a mismatch is reported where it appears
+    KernelMismatch mismatch;
+    for (size_t i = 0; i < count && !mismatch.found; i++) {
+        for (size_t l = 0; l < graph.layers.size(); l++) {
+            const Layer &layer = graph.layers[l];
+            std::vector<number_t> actual(output_size(layer));
+            interpreter.run_layer(l, &layer_inputs[l][i * input_size(layer)], actual.data());
+            if (std::memcmp(actual.data(), &layer_inputs[l + 1][i * output_size(layer)], actual.size() * sizeof(number_t)) != 0) {
+                mismatch.found = true;
+                mismatch.layer = l;
+                mismatch.input = i;
+                break;
+            }
+        }
+    }
+    return mismatch;
+}
+
+std::vector<LayerChoice> select_fastest_kernels(Interpreter &interpreter, const std::vector<number_t> &inputs) {
+    const Graph &graph = interpreter.graph();
+    auto layer_inputs = record_layer_inputs(graph, inputs);
+    const size_t count = inputs.size() / graph.input_size();
+
+    std::vector<LayerChoice> choices;
+    for (size_t l = 0; l < graph.layers.size(); l++) {
+        const Layer &layer = graph.layers[l];
+        const auto &in = layer_inputs[l];
+        const auto &expected = layer_inputs[l + 1];
+        std::vector<number_t> actual(expected.size());
+
+        // Time the candidates in turn within each round so that load changes on the machine affect them alike
+        std::vector<const KernelVariant *> candidates;
+        for (const auto &variant : kernel_variants())
+            if (variant.type == layer.type && variant.supports(layer))
+                candidates.push_back(&variant);
+        std::vector<double> best(candidates.size(), INFINITY);
+        for (size_t round = 0; round < TUNE_ROUNDS; round++) {
+            for (size_t c = 0; c < candidates.size(); c++) {
+                interpreter.select(l, candidates[c]->name);
+                for (size_t i = 0; i < count; i++)
+                    interpreter.run_layer(l, &in[i * input_size(layer)], &actual[i * output_size(layer)]);
+                if (actual != expected)
+                    continue;
+
+                size_t next = 0;
+                auto stats = measure([&] {
+                    size_t i = next++ % count;
+                    interpreter.run_layer(l, &in[i * input_size(layer)], &actual[i * output_size(layer)]);
+                }, TUNE_REPEATS, TUNE_ITERATIONS);
+                best[c] = std::min(best[c], stats.min_ns);
+            }
+        }
+
+        // Candidates start with the generic kernel
+        size_t chosen = 0;
+        for (size_t c = 1; c < candidates.size(); c++)
+            if (best[c] * TUNE_MIN_SPEEDUP < best[0] && best[c] < best[chosen])
+                chosen = c;
+        interpreter.select(l, candidates[chosen]->name);
+        choices.push_back({candidates[chosen]->name, best[chosen], best[0]});
+    }
+
+    // Layer timings on recorded activations miss what the layers do to each other's caches, so the plan must also win
+    // on the whole model against the generic kernels, timed in alternation like the candidates above
+    std::vector<number_t> output(graph.output_size());
+    size_t next = 0;
+    auto run_model = [&] { interpreter.run(&inputs[next++ % count * graph.input_size()], output.data()); };
+    double tuned_ns = INFINITY, generic_ns = INFINITY;
+    for (size_t round = 0; round < TUNE_ROUNDS; round++) {
+        for (size_t l = 0; l < choices.size(); l++)
+            interpreter.select(l, choices[l].variant);
+        tuned_ns = std::min(tuned_ns, measure(run_model, TUNE_REPEATS, TUNE_ITERATIONS).min_ns);
+        for (size_t l = 0; l < choices.size(); l++)
+            interpreter.select(l, "generic");
+        generic_ns = std::min(generic_ns, measure(run_model, TUNE_REPEATS, TUNE_ITERATIONS).min_ns);
+    }
+    if (tuned_ns < generic_ns) {
+        for (size_t l = 0; l < choices.size(); l++)
+            interpreter.select(l, choices[l].variant);
+    } else {
+        for (LayerChoice &choice : choices)
+            choice = {"generic", choice.generic_ns, choice.generic_ns};
+    }
+    return choices;
+}
+
+std::string cpu_model() {
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 10, "model name") != 0)
+            continue;
+        size_t start = line.find(':');
+        if (start == std::string::npos)
+            break;
+        start = line.find_first_not_of(" \t", start + 1);
+        return start == std::string::npos ? "unknown" : line.substr(start);
+    }
+    return "unknown";
+}
+
+static std::string cache_key(const Graph &graph) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(graph.hash()));
+    return cpu_model() + "\t" + hash + "\t";
+}
+
+bool load_tuned_kernels(Interpreter &interpreter, const char *cache) {
+    std::ifstream in(cache);
+    const std::string key = cache_key(interpreter.graph());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, key.size(), key) != 0)
+            continue;
+        std::istringstream kernels(line.substr(key.size()));
+        std::vector<std::string> names;
+        std::string name;
+        while (kernels >> name)
+            names.push_back(name);
+        if (names.size() != interpreter.graph().layers.size())
+            return false;
+        for (size_t l = 0; l < names.size(); l++)
+            if (!interpreter.select(l, names[l].c_str()))
+                return false;
+        return true;
+    }
+    return false;
+}
+
+void save_tuned_kernels(const Interpreter &interpreter, const char *cache) {
+    const std::string key = cache_key(interpreter.graph());
+    std::vector<std::string> lines;
+    std::ifstream in(cache);
+    std::string line;
+    while (std::getline(in, line))
+        if (!line.empty() && line.compare(0, key.size(), key) != 0)
+            lines.push_back(line);
+    in.close();
+
+    line = key;
+    for (size_t l = 0; l < interpreter.kernels().size(); l++)
+        line += (l ? " " : "") + std::string(interpreter.kernels()[l]->name);
+    lines.push_back(line);
+
+    std::ofstream out(cache);
+    for (const auto &entry : lines)
+        out << entry << "\n";
+    if (!out)
+        throw std::runtime_error(std::string("cannot write \"") + cache + "\": " + strerror(errno));
+}
+
+bool tune_kernels_cached(Interpreter &interpreter, const std::vector<number_t> &inputs, const char *cache) {
+    if (load_tuned_kernels(interpreter, cache))
+        return true;
+    select_fastest_kernels(interpreter, inputs);
+    save_tuned_kernels(interpreter, cache);
+    return false;
+}
@@ -0,0 +1,55 @@
+#ifndef ENGINE_TUNING_H
+#define ENGINE_TUNING_H
+
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+
+// A variant replaces the generic kernel of a layer only if it is at least this much faster
+static const double TUNE_MIN_SPEEDUP = 1.05;
+static const size_t TUNE_INPUTS = 8; // Inputs the tools tune on
+static const size_t TUNE_ROUNDS = 3;
+static const size_t TUNE_REPEATS = 10;
+static const size_t TUNE_ITERATIONS = 10;
+
+// Runs the graph with generic kernels on every input (concatenated) and keeps the input of each layer, concatenated
+// over inputs; the last entry holds the model outputs
+std::vector<std::vector<number_t>> record_layer_inputs(const Graph &graph, const std::vector<number_t> &inputs);
+
+// First layer and input on which the kernels selected in the interpreter differ from the generic ones
+struct KernelMismatch {
+    bool found = false;
+    size_t layer = 0;
+    size_t input = 0;
+};
+
+KernelMismatch compare_with_generic(Interpreter &interpreter, const std::vector<number_t> &inputs);
+
+// Timing of the kernel kept for one layer
+struct LayerChoice {
+    const char *variant;
+    double ns;         // Best time per call of the kept variant
+    double generic_ns; // Best time per call of the generic kernel
+};
+
+// Times every variant able to run each layer on the activations the layer receives for `inputs`, skips those whose
+// output differs from the generic kernel, and selects the fastest one in the interpreter. The resulting plan is kept
+// only if the whole model also runs faster with it than with the generic kernels; otherwise every layer goes back to
+// the generic kernel, so a tuning cache never stores a slower plan.
+std::vector<LayerChoice> select_fastest_kernels(Interpreter &interpreter, const std::vector<number_t> &inputs);
+
+// The "model name" of /proc/cpuinfo, "unknown" where it is not available
+std::string cpu_model();
+
+// Tuning cache: a text file with one line per CPU model and graph hash, "<cpu model>\t<hash>\t<kernel of every layer>"
+// with kernels separated by spaces. Loading selects the cached kernels and returns false when the file has no entry
+// for this CPU and graph or names a variant that no longer exists; saving replaces the entry of this CPU and graph.
+bool load_tuned_kernels(Interpreter &interpreter, const char *cache);
+void save_tuned_kernels(const Interpreter &interpreter, const char *cache);
+
+// Selects the cached kernels if possible, otherwise tunes on `inputs` and stores the result. Returns true on a cache
+// hit, which costs no benchmarking at all.
+bool tune_kernels_cached(Interpreter &interpreter, const std::vector<number_t> &inputs, const char *cache);
+
+#endif // ENGINE_TUNING_H
@@ -0,0 +1,114 @@
+#include "winograd.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "kernels.h"
+
+static const size_t TILE = 2;   // Outputs per tile
+static const size_t POINTS = 4; // Transformed values per tile
+static const size_t BLOCK = 8;  // Tiles accumulated in registers over all input channels
+
+static size_t padded_tiles(const Layer &layer) {
+    return (layer.out_samples / TILE + BLOCK - 1) / BLOCK * BLOCK;
+}
+
+bool conv1d_winograd_supports(const Layer &layer) {
+    return layer.size == 3 && layer.stride == 1;
+}
+
+// Scratch: transformed input [in_channels][POINTS][tiles], tiles zero-padded to a multiple of BLOCK
+size_t conv1d_winograd_scratch(const Layer &layer) {
+    return std::max(layer.in_channels * POINTS * padded_tiles(layer) * sizeof(number_t),
+                    layer.out_samples * sizeof(long_number_t));
+}
+
+std::shared_ptr<void> conv1d_winograd_prepare(const Layer &layer) {
+    auto state = std::make_shared<WinogradConvState>();
+    const size_t filters = layer.out_channels, in_channels = layer.in_channels;
+    state->weights.resize(filters * in_channels * POINTS);
+    for (size_t k = 0; k < filters; k++) {
+        int64_t bound = 0;
+        for (size_t z = 0; z < in_channels; z++) {
+            const number_t *g = layer.kernel + (k * in_channels + z) * 3;
+            const long_number_t u[POINTS] = {2 * g[0], g[0] + g[1] + g[2], g[0] - g[1] + g[2], 2 * g[2]};
+            for (size_t i = 0; i < POINTS; i++) {
+                state->weights[(k * in_channels + z) * POINTS + i] = u[i];
+                bound += std::abs(u[i]);
+                state->weights_fit &= u[i] == static_cast<number_t>(u[i]);
+            }
+        }
+        state->weight_bound = std::max(state->weight_bound, bound);
+    }
+    return state;
+}
+
+void conv1d_winograd(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state) {
+    WinogradConvState &winograd = *static_cast<WinogradConvState *>(state);
+    const size_t in_channels = layer.in_channels, in_samples = layer.in_samples;
+    const size_t filters = layer.out_channels, out_samples = layer.out_samples;
+    const size_t tiles = out_samples / TILE, padded = padded_tiles(layer);
+
+    // Every transformed input is at most twice the largest input magnitude, and every partial sum of the kernel is
+    // bounded by that times weight_bound
+    long_number_t max_input = 0;
+    for (size_t i = 0; i < input_size(layer); i++)
+        max_input = std::max(max_input, static_cast<long_number_t>(std::abs(input[i])));
+    winograd.calls++;
+    if (!winograd.weights_fit || 2 * max_input > std::numeric_limits<number_t>::max() ||
+        2 * max_input * winograd.weight_bound > std::numeric_limits<long_number_t>::max()) {
+        conv1d_generic(layer, input, output, scratch, nullptr);
+        return;
+    }
+    winograd.winograd_calls++;
+
+    number_t *transformed = static_cast<number_t *>(scratch);
+    for (size_t z = 0; z < in_channels; z++) {
+        const number_t *in = input + z * in_samples;
+        number_t *v = transformed + z * POINTS * padded;
+        for (size_t t = 0; t < tiles; t++) {
+            const number_t d0 = in[2 * t], d1 = in[2 * t + 1], d2 = in[2 * t + 2], d3 = in[2 * t + 3];
+            v[t] = d0 - d2;
+            v[padded + t] = d1 + d2;
+            v[2 * padded + t] = d2 - d1;
+            v[3 * padded + t] = d1 - d3;
+        }
+        for (size_t i = 0; i < POINTS; i++)
+            std::fill(v + i * padded + tiles, v + (i + 1) * padded, 0);
+    }
+
+    // Each block of tiles accumulates its POINTS products over all input channels in registers
+    const Activation activation = layer.activation;
+    for (size_t k = 0; k < filters; k++) {
+        const number_t *u = winograd.weights.data() + k * in_channels * POINTS;
+        const long_number_t bias = layer.bias[k];
+        number_t *out = output + k * out_samples;
+
+        for (size_t t0 = 0; t0 < tiles; t0 += BLOCK) {
+            long_number_t m[POINTS][BLOCK] = {};
+            for (size_t z = 0; z < in_channels; z++) {
+                const number_t *v = transformed + z * POINTS * padded + t0;
+                for (size_t i = 0; i < POINTS; i++)
+                    for (size_t t = 0; t < BLOCK; t++)
+                        m[i][t] += u[z * POINTS + i] * v[i * padded + t];
+            }
+            for (size_t t = 0; t < BLOCK && t0 + t < tiles; t++) {
+                out[2 * (t0 + t)] = activate(activation, scale_number_t((m[0][t] + m[1][t] + m[2][t]) / 2) + bias);
+                out[2 * (t0 + t) + 1] = activate(activation, scale_number_t((m[1][t] - m[2][t] - m[3][t]) / 2) + bias);
+            }
+        }
+
+        // Odd output count: the last position is computed directly
+        if (out_samples % TILE) {
+            const size_t pos_x = out_samples - 1;
+            long_number_t acc = 0;
+            for (size_t z = 0; z < in_channels; z++) {
+                const number_t *in = input + z * in_samples + pos_x;
+                const number_t *g = layer.kernel + (k * in_channels + z) * 3;
+                acc += in[0] * g[0] + in[1] * g[1] + in[2] * g[2];
+            }
+            out[pos_x] = activate(activation, scale_number_t(acc) + bias);
+        }
+    }
+}
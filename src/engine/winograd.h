@@ -0,0 +1,31 @@
+#ifndef ENGINE_WINOGRAD_H
+#define ENGINE_WINOGRAD_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "layer.h"
+
+// Winograd F(2,3) Conv1D for size 3, stride 1: each pair of outputs of a filter costs 4 multiplications per input
+// channel instead of 6, the input transform being shared by all filters.
+//
+// The transformed filter G·g has halves, so prepare() stores 2·G·g and the kernel halves the result, which is then
+// always even. Transformed weights and inputs are kept in number_t so that the products are int16 x int16 like in the
+// direct kernel. Integer sums being exact, the output matches the direct kernel bit for bit as long as the transformed
+// values fit number_t and no sum leaves the long_number_t range. Each call bounds them from the largest input
+// magnitude and falls back to the direct kernel when the bound does not hold, so the variant is exact for any input.
+struct WinogradConvState {
+    std::vector<number_t> weights; // [filters][in_channels][4], 2·G·g
+    int64_t weight_bound = 0;      // Largest sum of |2·G·g| over the channels and taps of one filter
+    bool weights_fit = true;       // Whether every 2·G·g fits number_t
+    uint64_t calls = 0;
+    uint64_t winograd_calls = 0;   // Calls within the range bound
+};
+
+bool conv1d_winograd_supports(const Layer &layer);
+size_t conv1d_winograd_scratch(const Layer &layer);
+std::shared_ptr<void> conv1d_winograd_prepare(const Layer &layer);
+void conv1d_winograd(const Layer &layer, const number_t *input, number_t *output, void *scratch, void *state);
+
+#endif // ENGINE_WINOGRAD_H
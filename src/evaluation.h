@@ -0,0 +1,165 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "dataset.h"
+#include "engine/activation_cache.h"
+#include "engine/interpreter.h"
+
+// Computes testing accuracy of a serialized graph, like evaluate() in main.cpp does for the generated model
+inline float evaluate(Interpreter &interpreter, const std::vector<float> &inputs, const std::vector<float> &labels) {
+    const Graph &graph = interpreter.graph();
+    const size_t input_size = graph.input_size();
+    const size_t output_size = graph.output_size();
+    const size_t count = std::min(inputs.size() / input_size, labels.size() / output_size);
+
+    std::vector<number_t> converted_input(input_size);
+    int rightlabels = 0;
+    for (size_t i = 0; i < count; i++) {
+        convert_input(&inputs[i * input_size], graph.input_channels, graph.input_samples, converted_input.data());
+        const size_t cls = interpreter.classify(converted_input.data()).label;
+        if (labels[i * output_size + cls] > 0) {
+            rightlabels++;
+        }
+    }
+    return rightlabels / static_cast<float>(count);
+}
+
+// Same on inputs already in the model's fixed-point layout (WAV samples, ...)
+inline float evaluate(Interpreter &interpreter, const std::vector<number_t> &inputs, const std::vector<float> &labels) {
+    const Graph &graph = interpreter.graph();
+    const size_t count = std::min(inputs.size() / graph.input_size(), labels.size() / graph.output_size());
+    int rightlabels = 0;
+    for (size_t i = 0; i < count; i++) {
+        const size_t cls = interpreter.classify(&inputs[i * graph.input_size()]).label;
+        if (labels[i * graph.output_size() + cls] > 0) {
+            rightlabels++;
+        }
+    }
+    return rightlabels / static_cast<float>(count);
+}
+
+// Same through an activation cache, each input resuming from its deepest cached layer output
+inline float evaluate(ActivationCache &cache, Interpreter &interpreter, const std::vector<number_t> &inputs,
+                      const std::vector<float> &labels) {
+    const Graph &graph = interpreter.graph();
+    const size_t count = std::min(inputs.size() / graph.input_size(), labels.size() / graph.output_size());
+    int rightlabels = 0;
+    for (size_t i = 0; i < count; i++) {
+        const size_t cls = cache.classify(interpreter, &inputs[i * graph.input_size()]).label;
+        if (labels[i * graph.output_size() + cls] > 0) {
+            rightlabels++;
+        }
+    }
+    return rightlabels / static_cast<float>(count);
+}
+
+// Same on `count` inputs in the model's fixed-point layout and their class index, from a mapped BinaryDataset
+inline float evaluate(Interpreter &interpreter, const number_t *inputs, const uint16_t *labels, size_t count) {
+    const size_t input_size = interpreter.graph().input_size();
+    size_t rightlabels = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (interpreter.classify(&inputs[i * input_size]).label == labels[i])
+            rightlabels++;
+    }
+    return rightlabels / static_cast<float>(count);
+}
+
+// Sequential evaluation: inputs are drawn in a seeded random order, without replacement, until a confidence interval
+// on the accuracy is narrower than `width` or lies entirely above or below `threshold` (negative for none)
+static const size_t SEQUENTIAL_FIRST_CHECK = 32;   // Inputs before the first look at the interval
+static const double SEQUENTIAL_CHECK_GROWTH = 1.25; // Each look comes after 25% more inputs than the previous one
+
+struct SequentialOptions {
+    double width = 0;
+    double threshold = -1;
+    double confidence = 0.95;
+    uint64_t seed = 42;
+};
+
+struct SequentialResult {
+    size_t evaluated = 0, total = 0, correct = 0;
+    double low = 0, high = 1; // Interval on the accuracy of the whole test set
+    const char *stop = "all inputs evaluated";
+    std::vector<size_t> confusion; // [actual][predicted] counts over the evaluated inputs
+
+    double accuracy() const {
+        return evaluated ? correct / double(evaluated) : 0;
+    }
+};
+
+// Two-sided normal quantile: z such that P(|Z| > z) = alpha
+inline double normal_quantile(double alpha) {
+    double low = 0, high = 40;
+    for (int i = 0; i < 100; i++) {
+        const double z = (low + high) / 2;
+        (std::erfc(z / std::sqrt(2.0)) > alpha ? low : high) = z;
+    }
+    return (low + high) / 2;
+}
+
+// Wilson score interval of `correct` out of `n` inputs drawn without replacement from `total`: the finite population
+// correction shrinks it to the exact accuracy once every input was drawn
+inline void wilson_interval(size_t correct, size_t n, size_t total, double z, double &low, double &high) {
+    const double p = correct / double(n);
+    const double fpc = total > 1 ? double(total - n) / (total - 1) : 0;
+    const double z2 = z * z * fpc;
+    const double center = (p + z2 / (2 * n)) / (1 + z2 / n);
+    const double half = std::sqrt(z2 * (p * (1 - p) / n + z2 / (4.0 * n * n))) / (1 + z2 / n);
+    low = std::max(0.0, center - half);
+    high = std::min(1.0, center + half);
+}
+
+// classify(i) returns the predicted class of input i and actual(i) its class, both below `classes`. Looking at the
+// interval after every input would make the confidence level meaningless, so the looks are spaced geometrically and
+// the k-th one (from 1) uses the level 1 - alpha / (k (k + 1)): these sum to alpha, so the interval holds with the
+// requested confidence whenever evaluation stops.
+template<typename Classify, typename Actual>
+SequentialResult evaluate_sequential(size_t total, size_t classes, const SequentialOptions &options, Classify classify, Actual actual) {
+    // Fisher-Yates on raw mt19937_64 output, the same order on every standard library
+    std::vector<size_t> order(total);
+    for (size_t i = 0; i < total; i++)
+        order[i] = i;
+    std::mt19937_64 rng(options.seed);
+    for (size_t i = total; i > 1; i--)
+        std::swap(order[i - 1], order[rng() % i]);
+
+    SequentialResult result;
+    result.total = total;
+    result.confusion.assign(classes * classes, 0);
+    const double alpha = 1 - options.confidence;
+    size_t look = 0, next_look = std::min(total, SEQUENTIAL_FIRST_CHECK);
+    for (size_t i = 0; i < total; i++) {
+        const size_t predicted = classify(order[i]), expected = actual(order[i]);
+        result.confusion[expected * classes + predicted]++;
+        result.correct += predicted == expected;
+        result.evaluated++;
+        if (result.evaluated < next_look)
+            continue;
+        look++;
+        next_look = std::min(total, static_cast<size_t>(std::ceil(result.evaluated * SEQUENTIAL_CHECK_GROWTH)));
+        wilson_interval(result.correct, result.evaluated, total, normal_quantile(alpha / (look * (look + 1.0))), result.low, result.high);
+        if (result.evaluated == total)
+            break;
+        if (result.high - result.low < options.width) {
+            result.stop = "interval narrower than the requested width";
+            break;
+        }
+        if (options.threshold >= 0 && result.low > options.threshold) {
+            result.stop = "interval above the threshold";
+            break;
+        }
+        if (options.threshold >= 0 && result.high < options.threshold) {
+            result.stop = "interval below the threshold";
+            break;
+        }
+    }
+    return result;
+}
+
+#endif // EVALUATION_H
@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "model.h"
+#include "engine/graph.h"
+#include "engine/interpreter.h"
+#include "engine/tuning.h"
+
+// Golden file: magic, u16 version, u8 FIXED_POINT, u8 reserved, u32 input count, u16 tensor count, then per tensor a
+// u16 name length, the name and its u32 value count, then for every input the values of every tensor in order.
+// The first tensor is the model input, the others the output of each layer of generated_graph().
+static const char GOLDEN_MAGIC[4] = {'G', 'S', 'C', 'V'};
+static const uint16_t GOLDEN_VERSION = 1;
+static const size_t GOLDEN_DEFAULT_INPUTS = 16;
+
+struct GoldenTensor {
+    std::string name;
+    size_t size;
+};
+
+struct Golden {
+    std::vector<GoldenTensor> tensors;
+    std::vector<std::vector<number_t>> values; // [input][all tensors back to back]
+
+    const number_t *tensor(size_t input, size_t index) const {
+        size_t offset = 0;
+        for (size_t t = 0; t < index; t++)
+            offset += tensors[t].size;
+        return values[input].data() + offset;
+    }
+};
+
+template<typename T>
+static void write_value(std::ofstream &out, T value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+static T read_value(std::ifstream &in) {
+    T value;
+    if (!in.read(reinterpret_cast<char *>(&value), sizeof(value)))
+        throw std::runtime_error("truncated golden file");
+    return value;
+}
+
+static void save_golden(const Golden &golden, const char *filename) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out)
+        throw std::runtime_error(std::string("cannot write \"") + filename + "\": " + strerror(errno));
+
+    out.write(GOLDEN_MAGIC, sizeof(GOLDEN_MAGIC));
+    write_value<uint16_t>(out, GOLDEN_VERSION);
+    write_value<uint8_t>(out, FIXED_POINT);
+    write_value<uint8_t>(out, 0);
+    write_value<uint32_t>(out, golden.values.size());
+    write_value<uint16_t>(out, golden.tensors.size());
+    for (const auto &tensor : golden.tensors) {
+        write_value<uint16_t>(out, tensor.name.size());
+        out.write(tensor.name.data(), tensor.name.size());
+        write_value<uint32_t>(out, tensor.size);
+    }
+    for (const auto &values : golden.values)
+        out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(number_t));
+    if (!out)
+        throw std::runtime_error(std::string("error writing \"") + filename + "\"");
+}
+
+static Golden load_golden(const char *filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        throw std::runtime_error(std::string("cannot open \"") + filename + "\": " + strerror(errno));
+
+    char magic[sizeof(GOLDEN_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, GOLDEN_MAGIC, sizeof(magic)) != 0)
+        throw std::runtime_error(std::string("\"") + filename + "\" is not a golden file");
+    if (read_value<uint16_t>(in) != GOLDEN_VERSION)
+        throw std::runtime_error("unsupported golden file version");
+    if (read_value<uint8_t>(in) != FIXED_POINT)
+        throw std::runtime_error("golden fixed point format differs from this build's FIXED_POINT");
+    read_value<uint8_t>(in);
+
+    Golden golden;
+    golden.values.resize(read_value<uint32_t>(in));
+    golden.tensors.resize(read_value<uint16_t>(in));
+    size_t values = 0;
+    for (auto &tensor : golden.tensors) {
+        tensor.name.resize(read_value<uint16_t>(in));
+        if (!in.read(&tensor.name[0], tensor.name.size()))
+            throw std::runtime_error("truncated golden file");
+        tensor.size = read_value<uint32_t>(in);
+        values += tensor.size;
+    }
+    for (auto &input : golden.values) {
+        input.resize(values);
+        if (!in.read(reinterpret_cast<char *>(input.data()), values * sizeof(number_t)))
+            throw std::runtime_error("truncated golden file");
+    }
+    return golden;
+}
+
+// Runs the generated layer functions in the order and with the buffers cnn() uses, and keeps every activation
+static Golden record_golden(const Graph &graph, const std::vector<float> &rows, size_t count) {
+    Golden golden;
+    golden.tensors.push_back({"input", graph.input_size()});
+    for (const Layer &layer : graph.layers)
+        golden.tensors.push_back({layer.name, output_size(layer)});
+
+    for (size_t i = 0; i < count; i++) {
+        std::vector<number_t> input(graph.input_size());
+        convert_input(&rows[i * graph.input_size()], graph.input_channels, graph.input_samples, input.data());
+        std::vector<number_t> values = input;
+
+        std::vector<number_t> in = input, out;
+        for (const Layer &layer : graph.layers) {
+            out.assign(output_size(layer), 0);
+            auto generated = std::find_if(generated_layers().begin(), generated_layers().end(),
+                                          [&](const GeneratedLayer &g) { return std::strcmp(g.name, layer.name) == 0; });
+            if (generated != generated_layers().end())
+                generated->run(in.data(), out.data());
+            else if (layer.type == LayerType::Flatten)
+                out = in; // flatten is a pointer cast in the generated code
+            else
+                throw std::runtime_error(std::string("no generated function for layer ") + layer.name);
+            values.insert(values.end(), out.begin(), out.end());
+            in = out;
+        }
+
+        // The chain must reproduce cnn() itself
+        number_t expected[MODEL_OUTPUT_SAMPLES];
+        cnn(reinterpret_cast<const number_t(*)[MODEL_INPUT_SAMPLES]>(input.data()), expected);
+        if (!std::equal(out.begin(), out.end(), expected))
+            throw std::runtime_error("generated layer chain differs from cnn() on input " + std::to_string(i));
+        golden.values.push_back(values);
+    }
+    return golden;
+}
+
+// Reports the first value of the first tensor that differs, false if there is none
+static bool report_mismatch(const Golden &golden, size_t input, size_t tensor, const number_t *actual, const char *path) {
+    const number_t *expected = golden.tensor(input, tensor);
+    const size_t size = golden.tensors[tensor].size;
+    auto diff = std::mismatch(expected, expected + size, actual);
+    if (diff.first == expected + size)
+        return false;
+    std::cerr << "Mismatch (" << path << "): input " << input << ", layer " << tensor - 1 << " ("
+              << golden.tensors[tensor].name << "), index " << diff.first - expected << ": expected " << *diff.first
+              << ", got " << *diff.second << std::endl;
+    return true;
+}
+
+// Plans and runs graphs whose shape the generated model does not have, such as a Flatten of the model input, and
+// checks run(), classify() and run_batch() against the layers run one by one
+static void check_plans() {
+    std::vector<number_t> weights(3 * 8 + 3);
+    for (size_t i = 0; i < weights.size(); i++)
+        weights[i] = static_cast<number_t>((i * 37 % 23) * 64 - 700);
+    Graph graph;
+    graph.input_channels = 2;
+    graph.input_samples = 4;
+    graph.layers.push_back({LayerType::Flatten, Activation::Linear, 2, 4, 0, 0, 0, 0, nullptr, nullptr, "flatten"});
+    graph.layers.push_back({LayerType::Dense, Activation::ReLU, 8, 1, 3, 0, 0, 0, &weights[0], &weights[24], "dense"});
+    for (Layer &layer : graph.layers)
+        infer_output_shape(layer);
+
+    Interpreter interpreter(graph);
+    const number_t inputs[2][8] = {{512, -256, 1024, 0, 77, -900, 300, 5}, {-512, 256, 0, 1000, -77, 900, -300, 50}};
+    std::vector<number_t> expected(2 * 3), outputs(2 * 3), logits(3);
+    for (size_t b = 0; b < 2; b++) {
+        interpreter.run_layer(1, inputs[b], &expected[b * 3]); // Flatten is a no-op on channels-first data
+        interpreter.run(inputs[b], &outputs[b * 3]);
+        interpreter.classify(inputs[b], logits.data());
+        if (!std::equal(logits.begin(), logits.end(), &expected[b * 3]))
+            throw std::runtime_error("classify() of a graph starting with Flatten differs from its layers");
+    }
+    if (outputs != expected)
+        throw std::runtime_error("run() of a graph starting with Flatten differs from its layers");
+    interpreter.run_batch(&inputs[0][0], outputs.data(), 2);
+    if (outputs != expected)
+        throw std::runtime_error("run_batch() of a graph starting with Flatten differs from its layers");
+
+    // 16 x 4097 values wrap to 16 in the 16-bit shape, which a Dense layer of 16 inputs would match
+    Graph wide;
+    wide.input_channels = 16;
+    wide.input_samples = 4097;
+    wide.layers.push_back({LayerType::Flatten, Activation::Linear, 16, 4097, 0, 0, 0, 0, nullptr, nullptr, "flatten"});
+    wide.layers.push_back({LayerType::Dense, Activation::ReLU, 16, 1, 1, 0, 0, 0, &weights[0], &weights[16], "dense"});
+    for (Layer &layer : wide.layers)
+        infer_output_shape(layer);
+    bool rejected = false;
+    try {
+        wide.validate();
+    } catch (const std::runtime_error &) {
+        rejected = true;
+    }
+    if (!rejected)
+        throw std::runtime_error("a Flatten of more than 65535 values passed validation");
+    std::cerr << "Arena plans check out" << std::endl;
+}
+
+int main(int argc, const char *argv[]) {
+    try {
+        if (argc == 2 && std::strcmp(argv[1], "--check-plans") == 0) {
+            check_plans();
+            return 0;
+        }
+
+        const Graph graph = generated_graph();
+
+        if (argc >= 4 && std::strcmp(argv[1], "--record") == 0) {
+            auto rows = readRowsFromFile(argv[3], graph.input_size());
+            size_t count = argc >= 5 ? std::strtoul(argv[4], NULL, 10) : GOLDEN_DEFAULT_INPUTS;
+            count = std::min(count, rows.size() / graph.input_size());
+            save_golden(record_golden(graph, rows, count), argv[2]);
+            std::cerr << "Recorded " << graph.layers.size() << " layers for " << count << " inputs" << std::endl;
+            return 0;
+        }
+
+        // Alternative kernel sets: a variant wherever it applies ("--kernel gemm") or on one layer ("--kernel
+        // conv1d_2=gemm"), later options overriding earlier ones, the tuner's choice, and the batch path
+        Interpreter interpreter(graph);
+        bool tune = false, batch = false;
+        int arg = 1;
+        for (; arg < argc - 1; arg++) {
+            if (std::strcmp(argv[arg], "--kernel") == 0 && arg + 2 < argc) {
+                const std::string option = argv[++arg];
+                const size_t equals = option.find('=');
+                const std::string variant = equals == std::string::npos ? option : option.substr(equals + 1);
+                bool selected = false;
+                for (size_t l = 0; l < graph.layers.size(); l++)
+                    if (equals == std::string::npos || option.compare(0, equals, graph.layers[l].name) == 0)
+                        selected |= interpreter.select(l, variant.c_str());
+                if (!selected)
+                    throw std::runtime_error("no layer can run kernel " + option);
+            } else if (std::strcmp(argv[arg], "--tune") == 0) {
+                tune = true;
+            } else if (std::strcmp(argv[arg], "--batch") == 0) {
+                batch = true;
+            } else {
+                break;
+            }
+        }
+        if (arg != argc - 1) {
+            std::cerr << "Usage: " << argv[0] << " --record golden.gscv testX.csv [count]" << std::endl;
+            std::cerr << "       " << argv[0] << " [--kernel [layer=]variant]... [--tune] [--batch] golden.gscv" << std::endl;
+            std::cerr << "       " << argv[0] << " --check-plans" << std::endl;
+            exit(1);
+        }
+
+        Golden golden = load_golden(argv[arg]);
+        if (golden.tensors.size() != graph.layers.size() + 1 || golden.tensors[0].size != graph.input_size())
+            throw std::runtime_error("golden file does not match the model");
+        for (size_t l = 0; l < graph.layers.size(); l++)
+            if (golden.tensors[l + 1].name != graph.layers[l].name || golden.tensors[l + 1].size != output_size(graph.layers[l]))
+                throw std::runtime_error(std::string("golden file does not match the model at layer ") + graph.layers[l].name);
+        const size_t count = golden.values.size();
+
+        if (tune) {
+            std::vector<number_t> inputs;
+            for (size_t i = 0; i < std::min(count, TUNE_INPUTS); i++)
+                inputs.insert(inputs.end(), golden.tensor(i, 0), golden.tensor(i, 0) + graph.input_size());
+            select_fastest_kernels(interpreter, inputs);
+        }
+        for (size_t l = 0; l < graph.layers.size(); l++)
+            std::cerr << (l ? " " : "Kernels: ") << graph.layers[l].name << "=" << interpreter.kernels()[l]->name;
+        std::cerr << std::endl;
+
+        // Every layer consumes what the previous one produced, so the first mismatch is where results diverge
+        for (size_t i = 0; i < count; i++) {
+            std::vector<number_t> in(golden.tensor(i, 0), golden.tensor(i, 0) + graph.input_size()), out;
+            for (size_t l = 0; l < graph.layers.size(); l++) {
+                out.assign(output_size(graph.layers[l]), 0);
+                interpreter.run_layer(l, in.data(), out.data());
+                if (report_mismatch(golden, i, l + 1, out.data(), "layer by layer"))
+                    exit(1);
+                in.swap(out);
+            }
+        }
+
+        if (batch) {
+            std::vector<number_t> inputs, outputs(count * graph.output_size());
+            for (size_t i = 0; i < count; i++)
+                inputs.insert(inputs.end(), golden.tensor(i, 0), golden.tensor(i, 0) + graph.input_size());
+            interpreter.run_batch(inputs.data(), outputs.data(), count);
+            for (size_t i = 0; i < count; i++)
+                if (report_mismatch(golden, i, graph.layers.size(), &outputs[i * graph.output_size()], "batch"))
+                    exit(1);
+        }
+        std::cerr << "All " << count << " inputs match the golden activations of " << graph.layers.size() << " layers"
+                  << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
@@ -1,4 +1,3 @@
-#include <algorithm>
 #include <array>
 #include <cstring>
 #include <fstream>
@@ -6,7 +5,8 @@
 #include <sstream>
 #include <vector>
 
-#include "model.h"
+#include "model.c" // The fused head calls the generated layer functions directly
+#include "utils/fused_head.h"
 
 // Reads input data from a CSV file
 template<int N>
@@ -49,7 +49,6 @@ void convert_input_vector(const std::array<float, Channels*Samples> &input, numb
 template<size_t InputDims, size_t OutputDims>
 float evaluate(const std::vector<std::array<float, InputDims>> &inputs, const std::vector<std::array<float, OutputDims>> &labels) {
     int rightlabels = 0;
-    std::array<number_t, OutputDims> outputs = {};
 
     for (size_t i = 0; i < inputs.size() && i < labels.size(); i++) {
         number_t converted_input[MODEL_INPUT_CHANNELS][MODEL_INPUT_SAMPLES];
@@ -57,11 +56,9 @@ float evaluate(const std::vector<std::array<float, InputDims>> &inputs, const st
         // Convert the input vector to a suitable format for the model
         convert_input_vector<MODEL_INPUT_CHANNELS, MODEL_INPUT_SAMPLES>(inputs.at(i), converted_input);
 
-        // Make a prediction using the model
-        cnn(converted_input, outputs.data());
-
-        // Find the index of the highest value in the output array
-        auto cls = std::max_element(outputs.begin(), outputs.end()) - outputs.begin();
+        // Make a prediction using the model, the head returns the index of the highest output
+        number_t max_logit;
+        auto cls = cnn_classify(converted_input, &max_logit);
 
         // Check if the predicted label matches the expected label
         if (labels.at(i).at(cls) > 0) {
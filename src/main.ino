@@ -7,13 +7,26 @@
 
 #include "utils/ADC3101.h"
 #include "utils/gsc_model.h"
+#include "utils/fused_head.h"
+#include "utils/resample.h"
 
-#define I2S_SAMPLE_RATE 16000  // [16000, 48000] supported by the microphone
+#define I2S_SAMPLE_RATE 16000  // [16000, 48000] supported by the microphone, 32000 or 48000 are decimated in-stream
 #define I2S_BITS_PER_SAMPLE 16 // I2S wordlength is 16
+#define MODEL_SAMPLE_RATE 16000 // Rate of the training recordings
+
+#if I2S_SAMPLE_RATE % MODEL_SAMPLE_RATE != 0
+#error "I2S_SAMPLE_RATE must be a multiple of MODEL_SAMPLE_RATE"
+#endif
+#define DECIMATION (I2S_SAMPLE_RATE / MODEL_SAMPLE_RATE)
+
+#if DECIMATION > 1
+static int16_t resample_coeffs[RESAMPLE_DECIMATION_TAPS(DECIMATION)];
+static int16_t resample_history[2 * RESAMPLE_DECIMATION_TAPS(DECIMATION)];
+static resampler_t resampler;
+#endif
 
 static number_t inputs[MODEL_INPUT_CHANNELS][MODEL_INPUT_SAMPLES]; // 1-channel, 16000 samples for 16kHz over 1s
 static volatile size_t sample_i = 0; // Index for inputs array samples dimension
-static number_t outputs[MODEL_OUTPUT_SAMPLES];
 static volatile boolean ready_for_inference = false; // Set to true when sample_i reaches the end of the inputs array
 
 // Nucleo-L476RG I2C3 on A5/A4
@@ -38,10 +51,20 @@ ADC3101 adc3101(Wire1);
 void processI2SData(uint8_t *data, size_t size) {
   int16_t *data16 = (int16_t *)data;
 
-  // Copy first channel into model inputs
-  for (size_t i = 0; i < size / 4 && sample_i + i < MODEL_INPUT_SAMPLES; i++, sample_i++) {
+  // Copy first channel into model inputs, as raw samples: training folds the input normalization into the first
+  // convolution (fold_normalization() in utils/training.py)
+#if DECIMATION > 1
+  // Low-pass filtered and decimated on the way; the filter state carries over from one DMA buffer to the next
+  int16_t decimated[I2S_BUFFER_SIZE / 4 / DECIMATION + 2];
+  size_t count = resample_process(&resampler, data16, size / 4, 2, decimated);
+  for (size_t i = 0; i < count && sample_i < MODEL_INPUT_SAMPLES; i++, sample_i++) {
+    inputs[0][sample_i] = decimated[i];
+  }
+#else
+  for (size_t i = 0; i < size / 4 && sample_i < MODEL_INPUT_SAMPLES; i++, sample_i++) {
     inputs[0][sample_i] = data16[i * 2];
   }
+#endif
 
   if (sample_i >= MODEL_INPUT_SAMPLES) {
     ready_for_inference = true;
@@ -77,6 +100,11 @@ void setup() {
 
   adc3101.setup();
 
+#if DECIMATION > 1
+  resample_design(I2S_SAMPLE_RATE, MODEL_SAMPLE_RATE, resample_coeffs);
+  resample_init(&resampler, I2S_SAMPLE_RATE, MODEL_SAMPLE_RATE, resample_coeffs, resample_history);
+#endif
+
   delay(500);
 
   // start I2S, MCLK enabled
@@ -106,18 +134,9 @@ void loop() {
     // Send signed 16-bit PCM little endian 1 channel
     //Serial.write((uint8_t*)inputs[0], MODEL_INPUT_SAMPLES*2);
 
-    // Predict
-    cnn(inputs, outputs);
-
-    // Get output class
-    unsigned int label = 0;
-    number_t max_val = outputs[0];
-    for (unsigned int i = 1; i < MODEL_OUTPUT_SAMPLES; i++) {
-      if (max_val < outputs[i]) {
-        max_val = outputs[i];
-        label = i;
-      }
-    }
+    // Predict, the fused head returns the output class and its value
+    number_t max_val;
+    unsigned int label = cnn_classify(inputs, &max_val);
 
     static char msg[32];
     snprintf(msg, sizeof(msg), "%d,%d,%d", label, max_val, (int)(millis() - t_start));
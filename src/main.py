@@ -6,6 +6,8 @@ from utils.downloader import get_bird_json, download_from_bird_json_infos
 from utils.training import create_test_file, create_model
 import kerascnn2c
 
+FIXED_POINT = 9
+
 
 def main():
     folder, file = "recordings", "testing_list.txt"
@@ -41,10 +43,10 @@ def main():
     create_test_file(folder, birds[0][0], file)
 
     # create model
-    model = create_model(folder, classes, file)
+    model = create_model(folder, classes, file, FIXED_POINT)
 
     # generate c code
-    res = kerascnn2c.Converter(output_path=Path('gsc_output'), fixed_point=9, number_type='int16_t',
+    res = kerascnn2c.Converter(output_path=Path('gsc_output'), fixed_point=FIXED_POINT, number_type='int16_t',
                                long_number_type='int32_t', number_min=-(2 ** 15),
                                number_max=(2 ** 15) - 1).convert_model(copy.deepcopy(model))
     with open('src/utils/gsc_model.h', 'w') as f:
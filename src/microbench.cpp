@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "model.h"
+#include "engine/counters.h"
+#include "engine/graph.h"
+#include "engine/interpreter.h"
+#include "engine/timing.h"
+#include "engine/tuning.h"
+
+static const size_t MICROBENCH_INPUTS = 8;
+static const size_t MICROBENCH_REPEATS = 30;
+static const double MICROBENCH_BATCH_NS = 200000; // Target duration of one timed batch of calls
+
+// Picks the iteration count so that one batch of calls lasts about MICROBENCH_BATCH_NS
+template<typename F>
+static size_t calibrate(F &&fn) {
+    auto stats = measure(fn, 1, 1);
+    return std::max<size_t>(1, static_cast<size_t>(MICROBENCH_BATCH_NS / std::max(stats.min_ns, 1.0)));
+}
+
+// Hardware counters of the calls, when asked for with --counters and available
+static PerfCounters *perf = nullptr;
+
+// One CSV row per kernel and variant; bytes counts the input, output and parameters touched by one call. With
+// --counters, per call counter values follow (empty where a counter is unavailable).
+static void print_header() {
+    std::cout << "kernel,variant,shape,ns_per_call,stddev_ns,min_ns,macs,macs_per_s,bytes,bytes_per_s,repeats,iterations";
+    if (perf)
+        std::cout << ",cycles,instructions,ipc,l1d_misses_per_mac,llc_misses_per_mac,branch_misses";
+    std::cout << std::endl;
+}
+
+static void print_counter(const CounterTotals &totals, HardwareCounter counter, double divisor) {
+    std::cout << ",";
+    if (totals.sum.has(counter) && divisor > 0)
+        std::cout << totals.sum[counter] / divisor;
+}
+
+static void print_row(const std::string &kernel, const std::string &variant, const std::string &shape, size_t macs,
+                      size_t bytes, const TimingStats &stats, const CounterTotals &counters = CounterTotals()) {
+    std::cout << kernel << "," << variant << "," << shape << "," << stats.mean_ns << "," << stats.stddev_ns << ","
+              << stats.min_ns << "," << macs << "," << macs / stats.mean_ns * 1e9 << "," << bytes << ","
+              << bytes / stats.mean_ns * 1e9 << "," << stats.repeats << "," << stats.iterations;
+    if (perf) {
+        const double calls = static_cast<double>(counters.calls);
+        print_counter(counters, HardwareCounter::Cycles, calls);
+        print_counter(counters, HardwareCounter::Instructions, calls);
+        std::cout << ",";
+        if (counters.ipc() > 0)
+            std::cout << counters.ipc();
+        print_counter(counters, HardwareCounter::L1DMisses, calls * macs);
+        print_counter(counters, HardwareCounter::LLCMisses, calls * macs);
+        print_counter(counters, HardwareCounter::BranchMisses, calls);
+    }
+    std::cout << std::endl;
+}
+
+static std::string shape_of(const Layer &layer) {
+    return std::to_string(layer.in_channels) + "x" + std::to_string(layer.in_samples) + "->" +
+           std::to_string(layer.out_channels) + "x" + std::to_string(layer.out_samples);
+}
+
+static size_t bytes_of(const Layer &layer) {
+    return (input_size(layer) + output_size(layer) + kernel_size(layer) + bias_size(layer)) * sizeof(number_t);
+}
+
+template<typename F>
+static TimingStats time_calls(F &&fn) {
+    return measure(fn, MICROBENCH_REPEATS, calibrate(fn));
+}
+
+// Counts one batch of as many calls as a timed batch, separately so that reading the counters never shows in timings
+template<typename F>
+static CounterTotals count_calls(F &&fn, const TimingStats &stats) {
+    CounterTotals totals;
+    if (perf)
+        totals.add(perf->count(fn, stats.iterations), stats.iterations);
+    return totals;
+}
+
+int main(int argc, const char *argv[]) {
+    // "--counters" adds hardware performance counter columns where the OS allows reading them
+    std::unique_ptr<PerfCounters> counters;
+    if (argc >= 2 && std::strcmp(argv[1], "--counters") == 0) {
+        counters.reset(new PerfCounters());
+        if (counters->available())
+            perf = counters.get();
+        else
+            std::cerr << "Hardware counters unavailable (" << counters->error() << "), not reporting them" << std::endl;
+        argc -= 1;
+        argv += 1;
+    }
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [--counters] [testX.csv]" << std::endl;
+        exit(1);
+    }
+
+    const Graph graph = generated_graph();
+    const size_t model_input_size = graph.input_size();
+    std::vector<number_t> inputs;
+    if (argc == 2) {
+        auto rows = readRowsFromFile(argv[1], model_input_size);
+        const size_t count = std::min(rows.size() / model_input_size, MICROBENCH_INPUTS);
+        inputs.resize(count * model_input_size);
+        for (size_t i = 0; i < count; i++)
+            convert_input(&rows[i * model_input_size], graph.input_channels, graph.input_samples, &inputs[i * model_input_size]);
+    }
+    if (inputs.empty())
+        inputs = random_inputs(MICROBENCH_INPUTS, model_input_size);
+    const size_t count = inputs.size() / model_input_size;
+
+    // Every kernel runs on the activations its layer receives from the real model
+    auto layer_inputs = record_layer_inputs(graph, inputs);
+    print_header();
+
+    for (size_t l = 0; l < graph.layers.size(); l++) {
+        const Layer &layer = graph.layers[l];
+        const auto &in = layer_inputs[l];
+        const auto &expected = layer_inputs[l + 1];
+        std::vector<number_t> actual(output_size(layer));
+
+        for (const auto &generated : generated_layers()) {
+            if (std::strcmp(generated.name, layer.name) != 0)
+                continue;
+            for (size_t i = 0; i < count; i++) {
+                generated.run(&in[i * input_size(layer)], actual.data());
+                if (!std::equal(actual.begin(), actual.end(), &expected[i * output_size(layer)])) {
+                    std::cerr << "Generated " << layer.name << " differs from the generic kernel" << std::endl;
+                    exit(1);
+                }
+            }
+            size_t next = 0;
+            auto run = [&] { generated.run(&in[next++ % count * input_size(layer)], actual.data()); };
+            auto stats = time_calls(run);
+            print_row(layer.name, "generated", shape_of(layer), macs(layer), bytes_of(layer), stats, count_calls(run, stats));
+        }
+
+        for (const auto &variant : kernel_variants()) {
+            if (variant.type != layer.type || !variant.supports(layer))
+                continue;
+            Interpreter interpreter(graph);
+            interpreter.select(l, variant.name);
+            size_t next = 0;
+            auto run = [&] { interpreter.run_layer(l, &in[next++ % count * input_size(layer)], actual.data()); };
+            auto stats = time_calls(run);
+            print_row(layer.name, variant.name, shape_of(layer), macs(layer), bytes_of(layer), stats, count_calls(run, stats));
+        }
+    }
+
+    // End to end: bytes are the model input, output and every parameter
+    size_t parameter_bytes = 0;
+    for (const Layer &layer : graph.layers)
+        parameter_bytes += (kernel_size(layer) + bias_size(layer)) * sizeof(number_t);
+    const size_t model_bytes = (model_input_size + graph.output_size()) * sizeof(number_t) + parameter_bytes;
+    const std::string model_shape = std::to_string(graph.input_channels) + "x" + std::to_string(graph.input_samples) +
+                                    "->" + std::to_string(graph.output_size());
+
+    number_t outputs[MODEL_OUTPUT_SAMPLES];
+    size_t next = 0;
+    auto run_generated = [&] {
+        cnn(reinterpret_cast<const number_t(*)[MODEL_INPUT_SAMPLES]>(&inputs[next++ % count * model_input_size]), outputs);
+    };
+    auto generated = time_calls(run_generated);
+    print_row("cnn", "generated", model_shape, graph.macs(), model_bytes, generated, count_calls(run_generated, generated));
+
+    Interpreter interpreter(graph);
+    auto run_interpreted = [&] { interpreter.run(&inputs[next++ % count * model_input_size], outputs); };
+    auto interpreted = time_calls(run_interpreted);
+    print_row("cnn", "interpreter", model_shape, graph.macs(), model_bytes, interpreted,
+              count_calls(run_interpreted, interpreted));
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "evaluation.h"
+#include "engine/graph.h"
+#include "engine/interpreter.h"
+#include "engine/pruned.h"
+#include "engine/timing.h"
+
+static const float SWEEP_RATIOS[] = {0.0f, 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f};
+static const size_t PRUNE_INPUTS = 8;
+static const size_t PRUNE_ROUNDS = 3;
+static const size_t PRUNE_REPEATS = 10;
+static const size_t PRUNE_ITERATIONS = 10;
+
+// Size and cost of a graph once the "pruned" kernels skip its zero blocks
+struct PrunedCost {
+    size_t macs = 0;
+    size_t nonzeros = 0;
+    size_t dense_bytes = 0;      // Conv1D and Dense weights stored densely
+    size_t compressed_bytes = 0; // Same weights in the block-sparse layout
+};
+
+static PrunedCost pruned_cost(const Graph &graph) {
+    PrunedCost cost;
+    for (const Layer &layer : graph.layers) {
+        if (layer.type != LayerType::Conv1D && layer.type != LayerType::Dense) {
+            cost.macs += macs(layer);
+            continue;
+        }
+        BlockSparseWeights weights = compress_blocks(layer);
+        cost.macs += pruned_macs(layer, weights);
+        cost.nonzeros += kernel_size(layer) - std::count(layer.kernel, layer.kernel + kernel_size(layer), 0);
+        cost.dense_bytes += kernel_size(layer) * sizeof(number_t);
+        cost.compressed_bytes += weights.bytes();
+    }
+    return cost;
+}
+
+// Best time per inference over all inputs, with the "pruned" kernels wherever they apply when `pruned` is set
+static double latency_ns(const Graph &graph, const std::vector<number_t> &inputs, bool pruned) {
+    Interpreter interpreter(graph);
+    for (size_t l = 0; pruned && l < graph.layers.size(); l++)
+        interpreter.select(l, "pruned");
+
+    const size_t count = inputs.size() / graph.input_size();
+    std::vector<number_t> output(graph.output_size());
+    double best = INFINITY;
+    for (size_t round = 0; round < PRUNE_ROUNDS; round++) {
+        size_t i = 0;
+        auto stats = measure([&] {
+            interpreter.run(&inputs[i * graph.input_size()], output.data());
+            i = (i + 1) % count;
+        }, PRUNE_REPEATS, PRUNE_ITERATIONS);
+        best = std::min(best, stats.min_ns);
+    }
+    return best;
+}
+
+// The block-sparse kernels must match the generic ones bit for bit on the pruned weights
+static void check_pruned(const Graph &graph, const std::vector<number_t> &inputs) {
+    Interpreter generic(graph), pruned(graph);
+    for (size_t l = 0; l < graph.layers.size(); l++)
+        pruned.select(l, "pruned");
+
+    std::vector<number_t> expected(graph.output_size()), actual(graph.output_size());
+    for (size_t i = 0; i < inputs.size() / graph.input_size(); i++) {
+        generic.run(&inputs[i * graph.input_size()], expected.data());
+        pruned.run(&inputs[i * graph.input_size()], actual.data());
+        if (expected != actual)
+            throw std::runtime_error("pruned kernels differ from the generic ones on input " + std::to_string(i));
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    PruningOptions structures;
+    bool any_structure = false;
+    float ratio = -1;
+    const char *export_path = nullptr;
+
+    int arg = 1;
+    for (; arg < argc && std::strncmp(argv[arg], "--", 2) == 0; arg++) {
+        if (std::strcmp(argv[arg], "--filters") == 0) {
+            structures.filters = 1;
+        } else if (std::strcmp(argv[arg], "--taps") == 0) {
+            structures.taps = 1;
+        } else if (std::strcmp(argv[arg], "--blocks") == 0) {
+            structures.blocks = 1;
+        } else if (std::strcmp(argv[arg], "--ratio") == 0 && arg + 1 < argc) {
+            ratio = std::strtof(argv[++arg], NULL);
+            continue;
+        } else if (std::strcmp(argv[arg], "--export") == 0 && arg + 1 < argc) {
+            export_path = argv[++arg];
+            continue;
+        } else {
+            break;
+        }
+        any_structure = true;
+    }
+    if ((argc - arg != 0 && argc - arg != 2) || (export_path && ratio < 0) || ratio > 1) {
+        std::cerr << "Usage: " << argv[0] << " [--filters] [--taps] [--blocks] [--ratio R [--export pruned.gscg]] [testX.csv testY.csv]" << std::endl;
+        exit(1);
+    }
+    // Without a structure selection, filters, taps and blocks are all pruned at the same ratio
+    if (!any_structure)
+        structures.filters = structures.taps = structures.blocks = 1;
+
+    try {
+        const Graph graph = generated_graph();
+
+        std::vector<float> inputs, labels;
+        std::vector<number_t> bench_inputs;
+        if (argc - arg == 2) {
+            inputs = readRowsFromFile(argv[arg], graph.input_size());
+            labels = readRowsFromFile(argv[arg + 1], graph.output_size());
+            const size_t count = std::min(PRUNE_INPUTS, inputs.size() / graph.input_size());
+            bench_inputs.resize(count * graph.input_size());
+            for (size_t i = 0; i < count; i++)
+                convert_input(&inputs[i * graph.input_size()], graph.input_channels, graph.input_samples, &bench_inputs[i * graph.input_size()]);
+        }
+        if (bench_inputs.empty())
+            bench_inputs = random_inputs(PRUNE_INPUTS, graph.input_size());
+
+        std::vector<float> ratios(std::begin(SWEEP_RATIOS), std::end(SWEEP_RATIOS));
+        if (ratio >= 0)
+            ratios.assign(1, ratio);
+
+        const double dense_ns = latency_ns(graph, bench_inputs, false);
+        std::cout << "Dense model: " << graph.macs() << " MACs, " << std::fixed << std::setprecision(1) << dense_ns / 1000
+                  << " us/inference" << std::endl;
+        std::cout << " ratio       MACs  nonzero weights  weight bytes (dense)  accuracy  us/inference  speedup" << std::endl;
+
+        for (float r : ratios) {
+            PruningOptions options;
+            options.filters = structures.filters * r;
+            options.taps = structures.taps * r;
+            options.blocks = structures.blocks * r;
+            const Graph pruned = prune_graph(graph, options);
+            check_pruned(pruned, bench_inputs);
+            const PrunedCost cost = pruned_cost(pruned);
+            const double ns = latency_ns(pruned, bench_inputs, true);
+
+            std::cout << std::setw(6) << std::setprecision(2) << r << std::setw(11) << cost.macs << std::setw(17)
+                      << cost.nonzeros << std::setw(14) << cost.compressed_bytes << " (" << std::setw(5)
+                      << cost.dense_bytes << ")" << std::setw(10) << std::setprecision(3);
+            if (!labels.empty()) {
+                Interpreter interpreter(pruned);
+                std::cout << evaluate(interpreter, inputs, labels);
+            } else {
+                std::cout << "-";
+            }
+            std::cout << std::setw(14) << std::setprecision(1) << ns / 1000 << std::setw(8) << std::setprecision(2)
+                      << dense_ns / ns << "x" << std::endl;
+
+            if (export_path)
+                pruned.save(export_path);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
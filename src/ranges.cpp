@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "engine/graph.h"
+#include "engine/kernels.h"
+#include "engine/ranges.h"
+
+static ValueRange union_of(const std::vector<ValueRange> &ranges) {
+    ValueRange range = ranges.front();
+    for (const ValueRange &r : ranges) {
+        range.min = std::min(range.min, r.min);
+        range.max = std::max(range.max, r.max);
+    }
+    return range;
+}
+
+static std::vector<ValueRange> partials_of(const LayerRanges &ranges) {
+    std::vector<ValueRange> partials;
+    for (const ChannelRange &channel : ranges.channels)
+        partials.push_back(channel.partial);
+    return partials;
+}
+
+static std::vector<ValueRange> outputs_of(const LayerRanges &ranges) {
+    std::vector<ValueRange> outputs;
+    for (const ChannelRange &channel : ranges.channels)
+        outputs.push_back(channel.output);
+    return outputs;
+}
+
+static std::string format(const ValueRange &range) {
+    return "[" + std::to_string(range.min) + ", " + std::to_string(range.max) + "]";
+}
+
+// Accumulator type a layer provably needs, from its partial sum width
+static const char *accumulator_type(int bits) {
+    return bits <= 16 ? "int16" : bits <= 32 ? "int32" : "int64 (long_number_t may overflow)";
+}
+
+int main(int argc, const char *argv[]) {
+    // "--input-range min max" bounds the model input in real units (like the CSV values) instead of the whole number_t
+    // range, "--filters" prints every filter/unit of Conv1D and Dense layers
+    ValueRange input = format_range();
+    bool filters = false;
+    int arg = 1;
+    for (; arg < argc; arg++) {
+        if (std::strcmp(argv[arg], "--input-range") == 0 && arg + 2 < argc) {
+            input.min = std::max<int64_t>(NUMBER_MIN, std::floor(std::strtod(argv[++arg], NULL) * (1 << FIXED_POINT)));
+            input.max = std::min<int64_t>(NUMBER_MAX, std::ceil(std::strtod(argv[++arg], NULL) * (1 << FIXED_POINT)));
+        } else if (std::strcmp(argv[arg], "--filters") == 0) {
+            filters = true;
+        } else {
+            break;
+        }
+    }
+    if (argc - arg > 1 || input.min > input.max) {
+        std::cerr << "Usage: " << argv[0] << " [--input-range min max] [--filters] [model.gscg]" << std::endl;
+        exit(1);
+    }
+
+    try {
+        const Graph graph = argc - arg == 1 ? Graph::load(argv[arg]) : generated_graph();
+        const auto ranges = analyze_ranges(graph, std::vector<ValueRange>(graph.input_channels, input));
+
+        std::cout << std::left << std::setw(20) << "layer" << std::setw(24) << "input" << std::setw(28) << "partial sums"
+                  << std::setw(6) << "bits" << std::setw(24) << "output" << "accumulator" << std::endl;
+        for (size_t l = 0; l < graph.layers.size(); l++) {
+            const Layer &layer = graph.layers[l];
+            const LayerRanges &layer_ranges = ranges[l];
+            const int bits = layer_ranges.accumulator_bits();
+            const bool weighted = layer.type == LayerType::Conv1D || layer.type == LayerType::Dense;
+            std::cout << std::setw(20) << layer.name << std::setw(24) << format(union_of(layer_ranges.inputs))
+                      << std::setw(28) << format(union_of(partials_of(layer_ranges))) << std::setw(6) << bits
+                      << std::setw(24) << format(union_of(outputs_of(layer_ranges)))
+                      << (weighted ? accumulator_type(bits) : "-") << std::endl;
+
+            for (size_t k = 0; filters && weighted && k < layer_ranges.channels.size(); k++) {
+                const ChannelRange &channel = layer_ranges.channels[k];
+                std::cout << "  " << std::setw(18) << k << std::setw(24) << "" << std::setw(28) << format(channel.partial)
+                          << std::setw(6) << channel.partial.bits() << format(channel.output) << std::endl;
+            }
+        }
+
+        // Kernel variants the weights and number_t format alone make safe, whatever the input range above
+        std::cout << std::endl << "Layers the narrow (int16 accumulator) kernels support:";
+        size_t narrow = 0;
+        for (const Layer &layer : graph.layers) {
+            const KernelVariant *variant = find_kernel(layer, "narrow");
+            if (variant) {
+                std::cout << " " << layer.name;
+                narrow++;
+            }
+        }
+        std::cout << (narrow ? "" : " none") << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,404 @@
+#ifndef RING_H
+#define RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "number.h"
+
+// Shared-memory transport between capture processes and gsc_daemon: a POSIX shared memory segment holding a bounded
+// multi-producer single-consumer ring of fixed-size windows and a companion ring of results, one result per window
+// slot. Windows of consecutive slots are stored back to back, and so are their results, so the daemon runs a batch of
+// ready slots in place: run_batch() reads the windows where producers wrote them and writes the logits where they
+// read them, without any copy.
+//
+// Slot at position pos (index pos % slots) goes through sequence values pos (free), pos + 1 (window published),
+// pos + 2 (result written), then pos + slots once its producer read the result, which frees it for the next lap.
+// Waiting spins for RING_SPIN iterations, then sleeps on a futex in the segment, so it works across processes. On a
+// single CPU the other side cannot make progress while we spin, so waiting sleeps right away.
+//
+// A producer that dies holding a slot would stop the ring: the consumer waits for that window forever, or the next
+// lap waits for its result to be collected. Slots record the pid of the producer that claimed them, and whenever the
+// consumer has waited RING_CHECK_NS for a window it frees the claimed or result slots whose producer exited. A
+// producer may fill its window in place as the audio comes in, so live producers are never hurried, unless the
+// consumer sets a timeout (set_timeout()) counted from the claim, or from the result for an uncollected one. A
+// producer that comes back to a freed slot gets an exception from publish() or wait_result().
+static const uint32_t RING_MAGIC = 0x4e525347; // "GSRN"
+static const uint32_t RING_VERSION = 2;
+static const size_t RING_SPIN = 4000;
+static const int64_t RING_CHECK_NS = 100000000; // 100 ms
+
+static inline int64_t monotonic_ns() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now); // System wide, so comparable between processes
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+class WindowRing {
+public:
+    // Creates the segment `name` (like "/gsc_ring"), replacing a stale one; the creator is the consumer
+    static WindowRing create(const char *name, uint32_t slots, uint32_t samples, uint32_t outputs) {
+        if (slots < 3)
+            throw std::runtime_error("a window ring needs at least 3 slots");
+        shm_unlink(name);
+        const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+            throw std::runtime_error(std::string("cannot create shared memory \"") + name + "\": " + std::strerror(errno));
+        const size_t bytes = segment_bytes(slots, samples, outputs);
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            const std::string error = std::strerror(errno);
+            close(fd);
+            shm_unlink(name);
+            throw std::runtime_error("cannot size shared memory: " + error);
+        }
+        WindowRing ring(fd, bytes, name, true);
+        Header *header = new (ring.base_) Header();
+        header->slots = slots;
+        header->samples = samples;
+        header->outputs = outputs;
+        ring.header_ = header;
+        ring.locate();
+        for (uint32_t i = 0; i < slots; i++)
+            new (&ring.states_[i]) SlotState();
+        for (uint32_t i = 0; i < slots; i++)
+            ring.states_[i].sequence.store(i, std::memory_order_relaxed);
+        header->magic = RING_MAGIC; // Last, a producer opening the segment earlier sees no valid ring yet
+        return ring;
+    }
+
+    // Opens the segment created by the daemon
+    static WindowRing open(const char *name) {
+        const int fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0)
+            throw std::runtime_error(std::string("cannot open shared memory \"") + name + "\": " + std::strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+            close(fd);
+            throw std::runtime_error(std::string("\"") + name + "\" is not a window ring");
+        }
+        WindowRing ring(fd, static_cast<size_t>(st.st_size), name, false);
+        ring.header_ = static_cast<Header *>(ring.base_);
+        if (ring.header_->magic != RING_MAGIC || ring.header_->version != RING_VERSION ||
+            segment_bytes(ring.header_->slots, ring.header_->samples, ring.header_->outputs) != ring.bytes_)
+            throw std::runtime_error(std::string("\"") + name + "\" is not a window ring of this version");
+        ring.locate();
+        return ring;
+    }
+
+    WindowRing(WindowRing &&other) noexcept
+        : base_(other.base_), bytes_(other.bytes_), name_(other.name_), owner_(other.owner_), pid_(other.pid_), header_(other.header_),
+          states_(other.states_), windows_(other.windows_), results_(other.results_), timeout_ns_(other.timeout_ns_),
+          stalled_pos_(other.stalled_pos_), stalled_ns_(other.stalled_ns_), reclaimed_(other.reclaimed_) {
+        other.base_ = nullptr;
+    }
+    WindowRing(const WindowRing &) = delete;
+    WindowRing &operator=(const WindowRing &) = delete;
+
+    ~WindowRing() {
+        if (!base_)
+            return;
+        munmap(base_, bytes_);
+        if (owner_)
+            shm_unlink(name_.c_str());
+    }
+
+    uint32_t slots() const {
+        return header_->slots;
+    }
+
+    uint32_t samples() const {
+        return header_->samples;
+    }
+
+    uint32_t outputs() const {
+        return header_->outputs;
+    }
+
+    number_t *window(uint64_t pos) {
+        return windows_ + pos % header_->slots * header_->samples;
+    }
+
+    number_t *result(uint64_t pos) {
+        return results_ + pos % header_->slots * header_->outputs;
+    }
+
+    // Producer: claims the next position, waiting while the ring is full, then fills window(pos) and publishes it
+    uint64_t claim() {
+        uint64_t pos = header_->tail.load(std::memory_order_relaxed);
+        for (;;) {
+            SlotState &state = states_[pos % header_->slots];
+            const uint64_t sequence = state.sequence.load(std::memory_order_acquire);
+            if (sequence == pos) {
+                if (header_->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    state.owner = pid_;
+                    state.claimed_ns = monotonic_ns();
+                    state.claimed_pos.store(pos, std::memory_order_release); // After the pid it vouches for
+                    return pos;
+                }
+            } else if (sequence < pos) {
+                // The previous lap of this slot is still in use
+                wait(header_->progress, header_->producers_waiting,
+                     [&] { return state.sequence.load(std::memory_order_acquire) >= pos; });
+                pos = header_->tail.load(std::memory_order_relaxed);
+            } else {
+                pos = header_->tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void publish(uint64_t pos) {
+        SlotState &state = states_[pos % header_->slots];
+        state.published_ns = monotonic_ns();
+        uint64_t expected = pos;
+        if (!state.sequence.compare_exchange_strong(expected, pos + 1, std::memory_order_release, std::memory_order_relaxed))
+            throw std::runtime_error("window ring slot reclaimed before it was published");
+        signal(header_->submitted, header_->consumer_waiting);
+    }
+
+    // Producer: waits for the result of pos, returns its label and frees the slot once `logits` (outputs() values,
+    // may be null) were copied
+    uint32_t wait_result(uint64_t pos, number_t *logits) {
+        SlotState &state = states_[pos % header_->slots];
+        wait(header_->progress, header_->producers_waiting,
+             [&] { return state.sequence.load(std::memory_order_acquire) != pos + 1; });
+        if (logits)
+            std::memcpy(logits, result(pos), header_->outputs * sizeof(number_t));
+        const uint32_t label = state.label;
+        uint64_t expected = pos + 2;
+        if (!state.sequence.compare_exchange_strong(expected, pos + header_->slots, std::memory_order_acq_rel))
+            throw std::runtime_error("window ring slot reclaimed before its result was read");
+        signal(header_->progress, header_->producers_waiting);
+        return label;
+    }
+
+    // Consumer: waits until the window at `head` is published and returns how many consecutive slots from there are,
+    // at most max_count and never across the end of the ring, so that they form one contiguous batch. Slots of dead
+    // or timed out producers are freed meanwhile, advancing `head` past those it was waiting for.
+    size_t wait_ready(uint64_t &head, size_t max_count) {
+        while (!wait(header_->submitted, header_->consumer_waiting, [&] { return ready(head); }, RING_CHECK_NS))
+            reclaim(head);
+        size_t count = 1;
+        const uint64_t end = head + std::min<uint64_t>(max_count, header_->slots - head % header_->slots);
+        while (head + count < end && ready(head + count))
+            count++;
+        return count;
+    }
+
+    // Positions claimed so far, the ones in flight being those past the consumer's head
+    uint64_t claimed() const {
+        return header_->tail.load(std::memory_order_relaxed);
+    }
+
+    int64_t published_ns(uint64_t pos) const {
+        return states_[pos % header_->slots].published_ns;
+    }
+
+    // Consumer: also frees the slots of live producers claimed more than `ns` ago without being published, or whose
+    // result went uncollected for that long. 0, the default, only frees those of exited producers.
+    void set_timeout(int64_t ns) {
+        timeout_ns_ = ns;
+    }
+
+    // Slots the consumer freed after their producer exited or timed out
+    uint64_t reclaimed() const {
+        return reclaimed_;
+    }
+
+    // Consumer: results of [head, head + count) are in result(), with their labels
+    void complete(uint64_t head, size_t count, const uint32_t *labels) {
+        for (size_t i = 0; i < count; i++) {
+            SlotState &state = states_[(head + i) % header_->slots];
+            state.label = labels[i];
+            state.completed_ns = monotonic_ns();
+            state.sequence.store(head + i + 2, std::memory_order_release);
+        }
+        signal(header_->progress, header_->producers_waiting);
+    }
+
+private:
+    // Each group of fields written by a different side gets its own cache line
+    struct Header {
+        uint32_t magic = 0;
+        uint32_t version = RING_VERSION;
+        uint32_t slots = 0, samples = 0, outputs = 0;
+        alignas(64) std::atomic<uint64_t> tail{0};         // Next position producers claim
+        alignas(64) std::atomic<uint32_t> submitted{0};    // Futex bumped when a window is published
+        std::atomic<uint32_t> consumer_waiting{0};
+        alignas(64) std::atomic<uint32_t> progress{0};     // Futex bumped when results are written or slots freed
+        std::atomic<uint32_t> producers_waiting{0};
+    };
+
+    struct alignas(64) SlotState {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<uint64_t> claimed_pos{UINT64_MAX}; // Position `owner` claimed at claimed_ns, written after them
+        int64_t claimed_ns = 0;
+        int64_t published_ns = 0;
+        int64_t completed_ns = 0;
+        pid_t owner = 0;
+        uint32_t label = 0;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "ring atomics must be lock-free to work across processes");
+
+    static size_t align_up(size_t bytes) {
+        return (bytes + 63) / 64 * 64;
+    }
+
+    static size_t segment_bytes(uint32_t slots, uint32_t samples, uint32_t outputs) {
+        return align_up(sizeof(Header)) + align_up(slots * sizeof(SlotState)) +
+               align_up(static_cast<size_t>(slots) * samples * sizeof(number_t)) +
+               align_up(static_cast<size_t>(slots) * outputs * sizeof(number_t));
+    }
+
+    WindowRing(int fd, size_t bytes, const char *name, bool owner) : bytes_(bytes), name_(name), owner_(owner), pid_(getpid()) {
+        base_ = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base_ == MAP_FAILED) {
+            base_ = nullptr;
+            if (owner)
+                shm_unlink(name);
+            throw std::runtime_error(std::string("cannot map shared memory: ") + std::strerror(errno));
+        }
+    }
+
+    void locate() {
+        char *base = static_cast<char *>(base_);
+        states_ = reinterpret_cast<SlotState *>(base + align_up(sizeof(Header)));
+        windows_ = reinterpret_cast<number_t *>(base + align_up(sizeof(Header)) + align_up(header_->slots * sizeof(SlotState)));
+        results_ = windows_ + align_up(static_cast<size_t>(header_->slots) * header_->samples * sizeof(number_t)) / sizeof(number_t);
+    }
+
+    bool ready(uint64_t pos) const {
+        return states_[pos % header_->slots].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    // Whether the producer known to have claimed pos exited; an unknown one (died before recording its pid) is left
+    // to the deadline
+    bool owner_gone(const SlotState &state, uint64_t pos) const {
+        return state.claimed_pos.load(std::memory_order_acquire) == pos && kill(state.owner, 0) != 0 && errno == ESRCH;
+    }
+
+    bool timed_out(int64_t since, int64_t now) const {
+        return timeout_ns_ > 0 && now - since > timeout_ns_;
+    }
+
+    // Consumer: frees the claimed but unpublished slots at `head` and the uncollected results whose producer exited
+    // or timed out, see the top of the file
+    void reclaim(uint64_t &head) {
+        const int64_t now = monotonic_ns();
+        bool freed = false;
+        while (header_->tail.load(std::memory_order_relaxed) > head && !ready(head)) {
+            SlotState &state = states_[head % header_->slots];
+            if (stalled_pos_ != head) {
+                stalled_pos_ = head;
+                stalled_ns_ = now;
+            }
+            // A producer that died before recording its claim is only caught by the timeout, from when we first saw it
+            const bool recorded = state.claimed_pos.load(std::memory_order_acquire) == head;
+            if (!owner_gone(state, head) && !timed_out(recorded ? state.claimed_ns : stalled_ns_, now))
+                break;
+            uint64_t expected = head;
+            if (!state.sequence.compare_exchange_strong(expected, head + header_->slots, std::memory_order_acq_rel))
+                break; // Published meanwhile
+            reclaimed_++;
+            freed = true;
+            head++;
+        }
+        for (uint64_t i = 0; i < header_->slots; i++) {
+            SlotState &state = states_[i];
+            uint64_t sequence = state.sequence.load(std::memory_order_acquire);
+            if (sequence < 2 || (sequence - 2) % header_->slots != i)
+                continue; // Not holding a result
+            const uint64_t pos = sequence - 2;
+            if (!owner_gone(state, pos) && !timed_out(state.completed_ns, now))
+                continue;
+            if (state.sequence.compare_exchange_strong(sequence, pos + header_->slots, std::memory_order_acq_rel)) {
+                reclaimed_++;
+                freed = true;
+            }
+        }
+        if (freed)
+            signal(header_->progress, header_->producers_waiting);
+    }
+
+    static void futex(std::atomic<uint32_t> &word, int op, uint32_t value, const timespec *timeout = NULL) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), op, value, timeout, NULL, 0);
+    }
+
+    static void cpu_pause() {
+#if defined(__SSE2__)
+        _mm_pause();
+#endif
+    }
+
+    // Spins, then sleeps on `word` until done(). Whoever makes done() true bumps `word` afterwards (signal()), so a
+    // sleeper either sees done() or has its futex value changed under it. Returns false if `timeout_ns` (when not 0)
+    // passed first.
+    template<typename F>
+    static bool wait(std::atomic<uint32_t> &word, std::atomic<uint32_t> &waiting, F done, int64_t timeout_ns = 0) {
+        static const size_t spin = std::thread::hardware_concurrency() > 1 ? RING_SPIN : 0;
+        for (size_t spins = 0; spins < spin; spins++) {
+            if (done())
+                return true;
+            cpu_pause();
+        }
+        const int64_t deadline = timeout_ns ? monotonic_ns() + timeout_ns : 0;
+        for (;;) {
+            const uint32_t seen = word.load();
+            if (done())
+                return true;
+            const int64_t left = deadline ? deadline - monotonic_ns() : 0;
+            if (deadline && left <= 0)
+                return false;
+            const timespec timeout = {static_cast<time_t>(left / 1000000000), static_cast<long>(left % 1000000000)};
+            waiting.fetch_add(1);
+            if (!done())
+                futex(word, FUTEX_WAIT, seen, deadline ? &timeout : NULL);
+            waiting.fetch_sub(1);
+        }
+    }
+
+    static void signal(std::atomic<uint32_t> &word, std::atomic<uint32_t> &waiting) {
+        word.fetch_add(1);
+        if (waiting.load())
+            futex(word, FUTEX_WAKE, INT_MAX);
+    }
+
+    void *base_ = nullptr;
+    size_t bytes_;
+    std::string name_;
+    bool owner_;
+    pid_t pid_;
+    Header *header_ = nullptr;
+    SlotState *states_ = nullptr;
+    number_t *windows_ = nullptr;
+    number_t *results_ = nullptr;
+    int64_t timeout_ns_ = 0;
+    uint64_t stalled_pos_ = UINT64_MAX; // Consumer: head it found claimed but unpublished, and since when
+    int64_t stalled_ns_ = 0;
+    uint64_t reclaimed_ = 0;
+};
+
+#endif // RING_H
@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "dataset.h"
+#include "evaluation.h"
+#include "wav.h"
+#include "engine/counters.h"
+#include "engine/graph.h"
+#include "engine/interpreter.h"
+#include "engine/normalization.h"
+#include "engine/sparse.h"
+#include "engine/tuning.h"
+
+// Prints the input density seen by every layer running the zero-skipping convolution
+static void print_sparsity(const Interpreter &interpreter) {
+    for (size_t l = 0; l < interpreter.graph().layers.size(); l++) {
+        if (interpreter.kernels()[l]->run != conv1d_sparse)
+            continue;
+        const SparsityStats &stats = static_cast<const SparseConvState *>(interpreter.state(l))->stats;
+        std::cerr << "Layer " << l << " (" << interpreter.graph().layers[l].name << "): input density " << stats.density() << ", zero-skipping on "
+                  << stats.sparse_calls << "/" << stats.calls << " inferences" << std::endl;
+    }
+}
+
+// Counts every layer on each input with the selected kernels, between two buffers of the largest tensor size
+static std::vector<CounterRow> count_layers(Interpreter &interpreter, const std::vector<number_t> &inputs, PerfCounters &perf) {
+    const Graph &graph = interpreter.graph();
+    size_t largest = graph.input_size();
+    for (const Layer &layer : graph.layers)
+        largest = std::max(largest, output_size(layer));
+    std::vector<number_t> in(largest), out(largest);
+
+    std::vector<CounterRow> rows;
+    for (size_t l = 0; l < graph.layers.size(); l++)
+        rows.push_back({std::to_string(l) + " " + graph.layers[l].name, CounterTotals(), macs(graph.layers[l])});
+    for (size_t i = 0; i < inputs.size() / graph.input_size(); i++) {
+        std::copy(&inputs[i * graph.input_size()], &inputs[(i + 1) * graph.input_size()], in.begin());
+        for (size_t l = 0; l < graph.layers.size(); l++) {
+            rows[l].totals.add(perf.count([&] { interpreter.run_layer(l, in.data(), out.data()); }));
+            std::swap(in, out);
+        }
+    }
+    return rows;
+}
+
+int main(int argc, const char *argv[]) {
+    // "--counters" reports hardware performance counters around CSV parsing and each layer, where the OS allows it
+    bool counters = false;
+    if (argc >= 2 && std::strcmp(argv[1], "--counters") == 0) {
+        counters = true;
+        argc -= 1;
+        argv += 1;
+    }
+
+    // Optional kernel variant to use wherever it supports the layer, e.g. "--kernel sparse", or "--tune" to keep the
+    // fastest variant of each layer on the first test inputs. "--tune-cache file" reuses the kernels tuned for this CPU
+    // and model in the cache file, and tunes and stores them there on a miss.
+    const char *kernel = nullptr;
+    const char *cache = nullptr;
+    bool tune = false;
+    if (argc >= 3 && std::strcmp(argv[1], "--kernel") == 0) {
+        kernel = argv[2];
+        argc -= 2;
+        argv += 2;
+    } else if (argc >= 3 && std::strcmp(argv[1], "--tune-cache") == 0) {
+        tune = true;
+        cache = argv[2];
+        argc -= 2;
+        argv += 2;
+    } else if (argc >= 2 && std::strcmp(argv[1], "--tune") == 0) {
+        tune = true;
+        argc -= 1;
+        argv += 1;
+    }
+
+    // A directory of recordings/<class>/*.wav can replace the CSV files, for a model taking raw samples: "--classes
+    // a,b,c" orders the labels (the sorted subdirectories by default), "--test-list file" keeps the recordings listed
+    // in training's testing_list.txt, "--recordings all" reads every .wav file instead of only the splitted_ ones
+    // training reads, and "--threads n" decodes the files on n threads. "--activation-cache file" keeps the layer
+    // outputs of every test input in the file, so that a later run with only the last layers retrained resumes from the
+    // deepest layer whose upstream weights did not change. "--ci-width w" and "--threshold t" evaluate the inputs in a
+    // random order ("--seed s") and stop once the "--confidence c" interval on the accuracy is narrower than w or
+    // clearly above or below t.
+    const char *activation_cache = nullptr;
+    SequentialOptions sequential_options;
+    bool sequential = false;
+    std::vector<std::string> classes;
+    std::set<std::string> test_list;
+    bool all_recordings = false;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    for (; argc >= 3; argc -= 2, argv += 2) {
+        if (std::strcmp(argv[1], "--classes") == 0) {
+            std::istringstream names(argv[2]);
+            for (std::string name; std::getline(names, name, ',');)
+                classes.push_back(name);
+        } else if (std::strcmp(argv[1], "--test-list") == 0) {
+            std::ifstream fin(argv[2]);
+            if (!fin) {
+                std::cerr << "Error opening \"" << argv[2] << "\": " << strerror(errno) << std::endl;
+                exit(1);
+            }
+            for (std::string path; std::getline(fin, path);)
+                test_list.insert(path);
+        } else if (std::strcmp(argv[1], "--recordings") == 0) {
+            all_recordings = std::strcmp(argv[2], "all") == 0;
+        } else if (std::strcmp(argv[1], "--threads") == 0) {
+            threads = std::max<size_t>(1, std::strtoul(argv[2], NULL, 10));
+        } else if (std::strcmp(argv[1], "--activation-cache") == 0) {
+            activation_cache = argv[2];
+        } else if (std::strcmp(argv[1], "--ci-width") == 0) {
+            sequential_options.width = std::strtod(argv[2], NULL);
+            sequential = true;
+        } else if (std::strcmp(argv[1], "--threshold") == 0) {
+            sequential_options.threshold = std::strtod(argv[2], NULL);
+            sequential = true;
+        } else if (std::strcmp(argv[1], "--confidence") == 0) {
+            sequential_options.confidence = std::min(std::max(std::strtod(argv[2], NULL), 0.5), 0.999999);
+        } else if (std::strcmp(argv[1], "--seed") == 0) {
+            sequential_options.seed = std::strtoull(argv[2], NULL, 10);
+        } else {
+            break;
+        }
+    }
+
+    if ((argc == 3 || argc == 4) && std::strcmp(argv[1], "--export") == 0) {
+        // Serialize the model compiled from gsc_output/, taking raw samples when given training's normalization.csv
+        try {
+            Graph graph = generated_graph();
+            if (argc == 4) {
+                auto values = readRowsFromFile(argv[3], 2);
+                if (values.size() != 2)
+                    throw std::runtime_error(std::string("\"") + argv[3] + "\" must hold one mean,std row");
+                InputNormalization normalization;
+                normalization.mean = values[0];
+                normalization.std = values[1];
+                graph = fold_input_normalization(graph, normalization);
+            }
+            graph.save(argv[2]);
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            exit(1);
+        }
+        return 0;
+    }
+    // Otherwise a single file after the model is a binary dataset (gsc_synth's), evaluated where it is mapped
+    struct stat st;
+    const bool wav = argc == 3 && stat(argv[2], &st) == 0 && S_ISDIR(st.st_mode);
+    const bool binary = argc == 3 && !wav;
+    if (argc != 4 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " [--counters] [--kernel variant | --tune | --tune-cache file] [--activation-cache file]"
+                  << " model.gscg testX.csv testY.csv" << std::endl;
+        std::cerr << "       " << argv[0] << " [--counters] [--kernel variant | --tune | --tune-cache file] [--classes a,b,c]"
+                  << " [--test-list file] [--recordings all] [--threads n] [--activation-cache file] raw.gscg recordings/" << std::endl;
+        std::cerr << "       " << argv[0] << " [--counters] [--kernel variant | --tune | --tune-cache file] [--activation-cache file]"
+                  << " raw.gscg dataset.gscd" << std::endl;
+        std::cerr << "       " << argv[0] << " --export model.gscg [normalization.csv]" << std::endl;
+        std::cerr << "Sequential evaluation, before the model: [--ci-width w] [--threshold t] [--confidence c] [--seed s]" << std::endl;
+        exit(1);
+    }
+
+    try {
+        Interpreter interpreter(Graph::load(argv[1]));
+        const Graph &graph = interpreter.graph();
+        for (size_t l = 0; kernel && l < graph.layers.size(); l++)
+            interpreter.select(l, kernel);
+
+        std::unique_ptr<PerfCounters> perf(counters ? new PerfCounters() : nullptr);
+        if (perf && !perf->available())
+            std::cerr << "Hardware counters unavailable (" << perf->error() << "), not reporting them" << std::endl;
+        else if (perf && !perf->error().empty())
+            std::cerr << "Some hardware counters unavailable (" << perf->error() << ")" << std::endl;
+        if (perf && !perf->available())
+            perf.reset();
+
+        // Counters only follow the calling thread, which then decodes all the recordings
+        CounterTotals parsing;
+        if (perf)
+            perf->start();
+        std::vector<float> inputs, labels;
+        std::vector<number_t> converted;
+        std::unique_ptr<BinaryDataset> dataset;
+        if (binary) {
+            dataset.reset(new BinaryDataset(argv[2]));
+            if (dataset->samples() != graph.input_size() || dataset->classes() != graph.output_size())
+                throw std::runtime_error("windows of " + std::to_string(dataset->samples()) + " samples in " +
+                                         std::to_string(dataset->classes()) + " classes for a model taking " +
+                                         std::to_string(graph.input_size()) + " with " + std::to_string(graph.output_size()) + " outputs");
+            if (dataset->windows() == 0)
+                throw std::runtime_error(std::string("no windows in \"") + argv[2] + "\"");
+            // Only the kernel checks, the per-layer counters and the activation cache need a copy of the windows
+            if (kernel || tune || perf || activation_cache) {
+                converted.assign(dataset->inputs(), dataset->inputs() + dataset->windows() * graph.input_size());
+                labels.assign(dataset->windows() * graph.output_size(), 0.0f);
+                for (size_t i = 0; i < dataset->windows(); i++)
+                    labels[i * graph.output_size() + dataset->labels()[i]] = 1.0f;
+            }
+        } else if (wav) {
+            const auto start = std::chrono::steady_clock::now();
+            WavDataset dataset = load_wav_dataset(argv[2], classes, graph.input_size(), perf ? 1 : threads, test_list, all_recordings);
+            if (dataset.classes.size() != graph.output_size())
+                throw std::runtime_error(std::to_string(dataset.classes.size()) + " classes for a model with " +
+                                         std::to_string(graph.output_size()) + " outputs");
+            converted = std::move(dataset.inputs);
+            labels = std::move(dataset.labels);
+            std::cerr << "Decoded " << dataset.paths.size() << " recordings of " << dataset.classes.size() << " classes in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                      << " ms" << std::endl;
+        } else {
+            inputs = readRowsFromFile(argv[2], graph.input_size());
+            labels = readRowsFromFile(argv[3], graph.output_size());
+        }
+        if (perf)
+            parsing.add(perf->stop());
+
+        const size_t count = binary ? dataset->windows() : (wav ? converted.size() : inputs.size()) / graph.input_size();
+        if (!binary && std::min(count, labels.size() / graph.output_size()) == 0)
+            throw std::runtime_error("no labelled test inputs to evaluate");
+        if (!wav && !binary && (kernel || tune || perf || activation_cache)) {
+            converted.resize(count * graph.input_size());
+            for (size_t i = 0; i < count; i++)
+                convert_input(&inputs[i * graph.input_size()], graph.input_channels, graph.input_samples, &converted[i * graph.input_size()]);
+        }
+
+        if (kernel || tune) {
+            std::vector<number_t> tuning_inputs(converted.begin(), converted.begin() + std::min(count, TUNE_INPUTS) * graph.input_size());
+            if (cache) {
+                const bool hit = tune_kernels_cached(interpreter, tuning_inputs, cache);
+                std::cerr << (hit ? "Kernels loaded from " : "Kernels tuned and stored in ") << cache << ":";
+                for (size_t l = 0; l < graph.layers.size(); l++)
+                    std::cerr << " " << interpreter.kernels()[l]->name;
+                std::cerr << std::endl;
+            } else if (tune) {
+                auto choices = select_fastest_kernels(interpreter, tuning_inputs);
+                for (size_t l = 0; l < choices.size(); l++)
+                    std::cerr << "Layer " << l << " (" << graph.layers[l].name << "): " << choices[l].variant << ", "
+                              << choices[l].ns / 1000 << " us (generic " << choices[l].generic_ns / 1000 << " us)" << std::endl;
+            }
+
+            // Selected kernels must reproduce the generic ones on the whole test set
+            KernelMismatch mismatch = compare_with_generic(interpreter, converted);
+            if (mismatch.found) {
+                std::cerr << "Error: layer " << mismatch.layer << " (" << graph.layers[mismatch.layer].name
+                          << ") differs from the generic kernel on input " << mismatch.input << std::endl;
+                exit(1);
+            }
+            std::cerr << "Selected kernels match the generic ones on " << count << " inputs" << std::endl;
+        }
+
+        if (sequential) {
+            std::unique_ptr<ActivationCache> cache(activation_cache ? new ActivationCache(activation_cache, graph) : nullptr);
+            const size_t input_size = graph.input_size(), outputs = graph.output_size();
+            std::vector<number_t> row(input_size);
+            auto classify = [&](size_t i) {
+                const number_t *input;
+                if (!converted.empty()) {
+                    input = &converted[i * input_size];
+                } else if (binary) {
+                    input = dataset->inputs() + i * input_size;
+                } else {
+                    convert_input(&inputs[i * input_size], graph.input_channels, graph.input_samples, row.data());
+                    input = row.data();
+                }
+                return (cache ? cache->classify(interpreter, input) : interpreter.classify(input)).label;
+            };
+            auto actual = [&](size_t i) -> size_t {
+                if (binary && labels.empty())
+                    return dataset->labels()[i];
+                const float *label = &labels[i * outputs];
+                return std::max_element(label, label + outputs) - label;
+            };
+            // Binary windows carry their class, unless the labels were expanded above
+            const size_t total = binary && labels.empty() ? count : std::min(count, labels.size() / outputs);
+            const SequentialResult result = evaluate_sequential(total, outputs, sequential_options, classify, actual);
+
+            std::cerr << "Testing accuracy: " << result.accuracy() << ", " << sequential_options.confidence * 100 << "% interval ["
+                      << result.low << ", " << result.high << "] after " << result.evaluated << " of " << result.total
+                      << " inputs (seed " << sequential_options.seed << "): " << result.stop << std::endl;
+            std::cerr << "Inferences saved: " << result.total - result.evaluated << " ("
+                      << 100.0 * (result.total - result.evaluated) / result.total << "%)" << std::endl;
+            std::cerr << "Confusion counts, a row per actual class and a column per predicted class:" << std::endl;
+            for (size_t a = 0; a < outputs; a++) {
+                for (size_t p = 0; p < outputs; p++)
+                    std::cerr << std::setw(8) << result.confusion[a * outputs + p];
+                std::cerr << std::endl;
+            }
+        } else if (activation_cache) {
+            const auto start = std::chrono::steady_clock::now();
+            ActivationCache cache(activation_cache, graph);
+            const size_t records = cache.records();
+            const float acc = evaluate(cache, interpreter, converted, labels);
+            std::cerr << "Testing accuracy: " << acc << std::endl;
+            std::cerr << "Evaluated in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                      << " ms, " << cache.layers_skipped() << " layer runs skipped and " << cache.layers_run() << " run" << std::endl;
+            for (size_t l = 0; l <= graph.layers.size(); l++) {
+                if (cache.resumed()[l] == 0)
+                    continue;
+                if (l == graph.layers.size())
+                    std::cerr << "  " << cache.resumed()[l] << " inputs computed from the input" << std::endl;
+                else
+                    std::cerr << "  " << cache.resumed()[l] << " inputs resumed after layer " << l << " (" << graph.layers[l].name << ")" << std::endl;
+            }
+            std::cerr << "Activation cache " << activation_cache << ": " << records << " records loaded, " << cache.records() - records
+                      << " added, " << cache.bytes() / 1048576.0 << " MiB" << std::endl;
+        } else {
+            auto acc = binary ? evaluate(interpreter, dataset->inputs(), dataset->labels(), count)
+                       : wav  ? evaluate(interpreter, converted, labels)
+                              : evaluate(interpreter, inputs, labels);
+            std::cerr << "Testing accuracy: " << acc << std::endl;
+        }
+        print_sparsity(interpreter);
+
+        if (perf) {
+            print_counter_table(std::cerr, {{binary ? "Dataset mapping" : wav ? "WAV decoding" : "CSV parsing", parsing,
+                                             binary ? converted.size() : (wav ? converted.size() : inputs.size()) + labels.size()}}, "value");
+            print_counter_table(std::cerr, count_layers(interpreter, converted, *perf), "MAC");
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
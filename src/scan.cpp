@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "wav.h"
+#include "engine/graph.h"
+#include "engine/parallel.h"
+#include "engine/scan.h"
+
+static const size_t SCAN_HOP = 8000; // A window every 0.5 s
+
+// What one thread produces for its segment of a round
+struct SegmentResult {
+    size_t first = 0; // Index of the first window
+    size_t count = 0;
+    std::vector<size_t> labels;
+    std::vector<number_t> logits;
+};
+
+int main(int argc, const char *argv[]) {
+    // "--hop n" is the number of samples between two windows, best a multiple of the model's cumulative stride so that
+    // the windows share their convolutions, and "--threads n" scans that many segments at once
+    size_t hop = SCAN_HOP, threads = std::max(1u, std::thread::hardware_concurrency());
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+        if (std::strcmp(argv[arg], "--hop") == 0)
+            hop = std::strtoul(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--threads") == 0)
+            threads = std::max<size_t>(1, std::strtoul(argv[arg + 1], NULL, 10));
+        else
+            break;
+    }
+    if (argc - arg != 2) {
+        std::cerr << "Usage: " << argv[0] << " [--hop samples] [--threads n] raw.gscg recording.wav" << std::endl;
+        exit(1);
+    }
+
+    try {
+        const Graph graph = Graph::load(argv[arg]);
+        const WavFile wav(argv[arg + 1]);
+        ModelRateReader reader(wav, 0);
+
+        std::vector<std::unique_ptr<Scanner>> scanners;
+        for (size_t t = 0; t < threads; t++)
+            scanners.emplace_back(new Scanner(graph, hop));
+        const Scanner &scanner = *scanners[0];
+        const size_t total = scanner.windows(reader.frames()), per_segment = scanner.segment_windows();
+        const size_t segments = (total + per_segment - 1) / per_segment;
+        std::cerr << "Scanning " << total << " windows in " << segments << " segments of " << per_segment;
+        if (scanner.trunk_layers() > 0)
+            std::cerr << ", layers 0-" << scanner.trunk_layers() - 1 << " run once per segment";
+        std::cerr << std::endl;
+
+        std::cout << "start_s,label";
+        for (size_t u = 0; u < scanner.outputs(); u++)
+            std::cout << ",logit" << u;
+        std::cout << std::endl;
+
+        // Each round scans one segment per thread, then prints them in order: memory stays at the samples of one round
+        // whatever the length of the recording, which is only mapped and read (resampled if needed) as rounds go
+        const auto start = std::chrono::steady_clock::now();
+        WorkerPool pool(threads);
+        std::vector<number_t> signal; // Model rate samples from signal_start on
+        size_t signal_start = 0;
+        std::vector<SegmentResult> results(threads);
+        for (size_t round = 0; round * threads < segments; round++) {
+            const size_t begin = round * threads * per_segment * hop;
+            const size_t last = std::min(segments, (round + 1) * threads) - 1;
+            const size_t end = last * per_segment * hop + scanner.segment_samples();
+            if (signal_start + signal.size() <= begin) {
+                // With a hop longer than the window, some samples belong to no window at all
+                std::vector<number_t> skipped(begin - signal_start - signal.size());
+                reader.read(skipped.data(), skipped.size());
+                signal.clear();
+            } else {
+                signal.erase(signal.begin(), signal.begin() + (begin - signal_start));
+            }
+            signal_start = begin;
+            const size_t kept = signal.size();
+            signal.resize(end - begin, 0);
+            reader.read(&signal[kept], signal.size() - kept);
+
+            auto scan_segment = [&](size_t slice) {
+                const size_t segment = round * threads + slice;
+                SegmentResult &result = results[slice];
+                result.count = 0;
+                if (segment >= segments)
+                    return;
+                result.first = segment * per_segment;
+                result.count = std::min(per_segment, total - result.first);
+                result.labels.resize(result.count);
+                result.logits.resize(result.count * scanner.outputs());
+
+                scanners[slice]->scan(&signal[result.first * hop - begin], result.count, result.labels.data(), result.logits.data());
+            };
+            pool.run(scan_segment);
+
+            for (const SegmentResult &result : results) {
+                for (size_t w = 0; w < result.count; w++) {
+                    std::cout << double((result.first + w) * hop) / WAV_MODEL_RATE << "," << result.labels[w];
+                    for (size_t u = 0; u < scanner.outputs(); u++)
+                        std::cout << "," << result.logits[w * scanner.outputs() + u] / double(1 << FIXED_POINT);
+                    std::cout << "\n";
+                }
+            }
+        }
+        std::cout.flush();
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double audio = double(wav.frames()) / wav.sample_rate();
+        std::cerr << "Scanned " << audio << " s of audio in " << seconds << " s on " << threads << " thread(s): "
+                  << audio / seconds << "x real time" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#ifndef SERVING_H
+#define SERVING_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Protocol of gsc_daemon over a Unix domain socket, in host byte order since both ends share the machine. A client
+// sends any number of requests on one connection, each answered once its batch ran; answers may come out of order
+// and carry the id of their request. A malformed request closes the connection.
+static const uint32_t REQUEST_MAGIC = 0x52435347;  // "GSCR"
+static const uint32_t RESPONSE_MAGIC = 0x41435347; // "GSCA"
+
+// Followed by `samples` int16 values: one window of raw 16 kHz audio, as many samples as the model input
+struct RequestHeader {
+    uint32_t magic;
+    uint32_t id;
+    uint32_t samples;
+};
+
+// Followed by `logits` int16 model outputs
+struct ResponseHeader {
+    uint32_t magic;
+    uint32_t id;
+    uint32_t label; // Index of the largest logit
+    uint32_t logits;
+};
+
+// Reads exactly `bytes` bytes, false on end of file or error
+inline bool read_full(int fd, void *buffer, size_t bytes) {
+    char *data = static_cast<char *>(buffer);
+    while (bytes > 0) {
+        const ssize_t n = read(fd, data, bytes);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Writes exactly `bytes` bytes without raising SIGPIPE on a closed peer, false on error
+inline bool write_full(int fd, const void *buffer, size_t bytes) {
+    const char *data = static_cast<const char *>(buffer);
+    while (bytes > 0) {
+        const ssize_t n = send(fd, data, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+inline sockaddr_un unix_address(const char *path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(address.sun_path))
+        throw std::runtime_error(std::string("socket path too long: ") + path);
+    std::strcpy(address.sun_path, path);
+    return address;
+}
+
+// Listening socket at `path`, replacing a stale socket file left by a previous run; any other file there is an error,
+// not something to delete
+inline int listen_unix(const char *path, int backlog = 64) {
+    const sockaddr_un address = unix_address(path);
+    struct stat st;
+    if (lstat(path, &st) == 0 && !S_ISSOCK(st.st_mode))
+        throw std::runtime_error("\"" + std::string(path) + "\" exists and is not a socket");
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    if (unlink(path) != 0 && errno != ENOENT) {
+        const std::string error = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error("cannot replace \"" + std::string(path) + "\": " + error);
+    }
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, backlog) != 0) {
+        const std::string error = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error("cannot listen on \"" + std::string(path) + "\": " + error);
+    }
+    return fd;
+}
+
+inline int connect_unix(const char *path) {
+    const sockaddr_un address = unix_address(path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        const std::string error = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error("cannot connect to \"" + std::string(path) + "\": " + error);
+    }
+    return fd;
+}
+
+#endif // SERVING_H
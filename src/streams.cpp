@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dataset.h"
+#include "wav.h"
+#include "engine/graph.h"
+#include "engine/interpreter.h"
+#include "engine/parallel.h"
+#include "engine/timing.h"
+#include "engine/tuning.h"
+
+static const size_t STREAMS_HOP = 8000;   // A window every 0.5 s
+static const size_t STREAMS_BLOCK = 1600; // Samples per capture block, 100 ms
+
+typedef std::chrono::steady_clock Clock;
+
+// Last window of a stream, slid by `hop` samples at a time as blocks are captured
+class SlidingWindow {
+public:
+    SlidingWindow(size_t window, size_t hop) : window_(window), hop_(hop) {}
+
+    // Appends captured samples and calls emit(window) for every window completed by them
+    template<typename F>
+    void push(const number_t *samples, size_t count, F emit) {
+        for (size_t i = 0; i < count; i++) {
+            buffer_.push_back(samples[i]);
+            if (buffer_.size() == window_) {
+                emit(buffer_.data());
+                buffer_.erase(buffer_.begin(), buffer_.begin() + hop_);
+            }
+        }
+    }
+
+private:
+    const size_t window_, hop_;
+    std::vector<number_t> buffer_;
+};
+
+// One microphone: a channel of a WAV file, fed block by block as if it was being captured. Windows may finish out of
+// order on the pool; their results are released in window order, and lag is measured when a result is released.
+struct Stream {
+    std::string name;
+    std::vector<number_t> audio; // At the model rate
+    std::unique_ptr<SlidingWindow> window;
+    uint64_t submitted = 0;
+
+    std::mutex mutex;
+    uint64_t released = 0;
+    std::map<uint64_t, uint32_t> done; // Labels of windows finished ahead of an earlier one
+    std::vector<uint32_t> labels;
+    std::vector<double> lags_ns;
+};
+
+static double thread_cpu_ns() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) * 1e9 + now.tv_nsec;
+}
+
+int main(int argc, const char *argv[]) {
+    // "--threads n" sizes the work-stealing pool (one interpreter per thread), "--hop n" is the number of samples
+    // between two windows of a stream, "--streams n" cycles through the WAV channels until there are n streams, and
+    // "--speed f" feeds the recordings at f times real time, 0 as fast as possible to measure the capacity
+    size_t threads = std::max(1u, std::thread::hardware_concurrency()), hop = STREAMS_HOP, stream_count = 0;
+    double speed = 1;
+    const char *cache = nullptr;
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+        if (std::strcmp(argv[arg], "--threads") == 0)
+            threads = std::max<size_t>(1, std::strtoul(argv[arg + 1], NULL, 10));
+        else if (std::strcmp(argv[arg], "--hop") == 0)
+            hop = std::strtoul(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--streams") == 0)
+            stream_count = std::strtoul(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--speed") == 0)
+            speed = std::strtod(argv[arg + 1], NULL);
+        else if (std::strcmp(argv[arg], "--tune-cache") == 0)
+            cache = argv[arg + 1];
+        else
+            break;
+    }
+    if (argc - arg < 2 || hop == 0 || speed < 0) {
+        std::cerr << "Usage: " << argv[0] << " [--threads n] [--hop samples] [--streams n] [--speed f] [--tune-cache file]"
+                  << " model.gscg recording.wav..." << std::endl;
+        exit(1);
+    }
+
+    std::vector<std::unique_ptr<Interpreter>> interpreters;
+    std::vector<std::unique_ptr<Stream>> streams;
+    size_t window;
+    try {
+        const Graph graph = Graph::load(argv[arg]);
+        window = graph.input_size();
+        if (hop > window)
+            throw std::runtime_error("the hop cannot exceed the " + std::to_string(window) + "-sample window");
+        for (size_t t = 0; t < threads; t++) {
+            interpreters.emplace_back(new Interpreter(graph));
+            if (!cache)
+                continue;
+            if (t == 0) {
+                const bool hit = tune_kernels_cached(*interpreters[0], random_inputs(TUNE_INPUTS, window), cache);
+                std::cerr << (hit ? "Kernels loaded from " : "Kernels tuned and stored in ") << cache << std::endl;
+            }
+            for (size_t l = 0; l < graph.layers.size(); l++)
+                interpreters[t]->select(l, interpreters[0]->kernels()[l]->name);
+        }
+
+        // Every channel of every file is a microphone of its own, resampled to the model rate if needed
+        std::vector<std::pair<std::string, std::vector<number_t>>> channels;
+        for (int a = arg + 1; a < argc; a++) {
+            const WavFile wav(argv[a]);
+            for (size_t c = 0; c < wav.channels(); c++) {
+                ModelRateReader reader(wav, c);
+                std::vector<number_t> audio(reader.frames());
+                reader.read(audio.data(), audio.size());
+                channels.emplace_back(wav.path() + (wav.channels() > 1 ? ":" + std::to_string(c) : ""), std::move(audio));
+            }
+        }
+        if (stream_count == 0)
+            stream_count = channels.size();
+        for (size_t s = 0; s < stream_count; s++) {
+            streams.emplace_back(new Stream());
+            streams[s]->name = channels[s % channels.size()].first;
+            if (s >= channels.size())
+                streams[s]->name += "#" + std::to_string(s / channels.size());
+            streams[s]->audio = channels[s % channels.size()].second;
+            streams[s]->window.reset(new SlidingWindow(window, hop));
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+
+    // Streams start together; a window is due when its last sample is captured
+    const Clock::time_point start = Clock::now();
+    auto captured = [&](size_t samples) {
+        const double seconds = speed > 0 ? samples / (WAV_MODEL_RATE * speed) : 0;
+        return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    };
+    std::vector<double> busy_ns(threads); // CPU time of the windows run by each thread
+    size_t longest = 0;
+    for (const auto &stream : streams)
+        longest = std::max(longest, stream->audio.size());
+
+    {
+        StealingPool pool(threads);
+        for (size_t block = 0; block < longest; block += STREAMS_BLOCK) {
+            const size_t end = std::min(longest, block + STREAMS_BLOCK);
+            std::this_thread::sleep_until(captured(end));
+            for (size_t s = 0; s < streams.size(); s++) {
+                Stream *stream = streams[s].get();
+                if (block >= stream->audio.size())
+                    continue;
+                const size_t count = std::min(end, stream->audio.size()) - block;
+                stream->window->push(&stream->audio[block], count, [&](const number_t *samples) {
+                    const uint64_t sequence = stream->submitted++;
+                    auto input = std::make_shared<std::vector<number_t>>(samples, samples + window);
+                    // Keeping a stream on one thread keeps its windows in order unless another thread steals them
+                    pool.submit(s, [&, stream, sequence, input](size_t worker) {
+                        const double cpu = thread_cpu_ns();
+                        const uint32_t label = static_cast<uint32_t>(interpreters[worker]->classify(input->data()).label);
+                        busy_ns[worker] += thread_cpu_ns() - cpu;
+
+                        std::lock_guard<std::mutex> lock(stream->mutex);
+                        stream->done[sequence] = label;
+                        const Clock::time_point now = Clock::now();
+                        for (auto next = stream->done.begin(); next != stream->done.end() && next->first == stream->released;
+                             next = stream->done.erase(next)) {
+                            const Clock::time_point due = captured(window + stream->released * hop);
+                            stream->labels.push_back(next->second);
+                            stream->lags_ns.push_back(std::chrono::duration<double, std::nano>(now - due).count());
+                            stream->released++;
+                        }
+                    });
+                });
+            }
+        }
+        pool.wait_idle();
+        std::cerr << pool.steals() << " windows stolen by another thread" << std::endl;
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Labels in window order, the start of each window in seconds of its recording
+    std::cout << "stream,window,start_s,label" << std::endl;
+    size_t windows = 0;
+    for (const auto &stream : streams) {
+        for (size_t i = 0; i < stream->labels.size(); i++)
+            std::cout << stream->name << "," << i << "," << double(i * hop) / WAV_MODEL_RATE << "," << stream->labels[i] << std::endl;
+        windows += stream->labels.size();
+    }
+
+    std::cerr << std::fixed << std::setprecision(1);
+    double worst_lag_ns = 0;
+    if (speed > 0) {
+        std::cerr << "Lag behind real time (ms), from the capture of a window's last sample to its result:" << std::endl;
+        std::cerr << "stream,windows,p50,p99,max" << std::endl;
+        for (const auto &stream : streams) {
+            std::vector<double> lags = stream->lags_ns;
+            std::sort(lags.begin(), lags.end());
+            const double max = lags.empty() ? 0 : lags.back();
+            worst_lag_ns = std::max(worst_lag_ns, max);
+            std::cerr << stream->name << "," << lags.size() << "," << percentile(lags, 0.5) / 1e6 << ","
+                      << percentile(lags, 0.99) / 1e6 << "," << max / 1e6 << std::endl;
+        }
+    }
+
+    // A real-time stream needs rate / hop windows per second; the CPU time per window bounds how many the cores keep up
+    // with, whatever the pacing of this run
+    double busy = 0;
+    for (double ns : busy_ns)
+        busy += ns;
+    const size_t cores = std::min<size_t>(threads, std::max(1u, std::thread::hardware_concurrency()));
+    const double per_stream = double(WAV_MODEL_RATE) / hop;
+    const double capacity = windows && busy > 0 ? cores * 1e9 / (busy / windows) : 0;
+    std::cerr << windows << " windows of " << streams.size() << " streams in " << seconds << " s ("
+              << windows / seconds << " windows/s) on " << threads << " thread(s), " << busy / 1e3 / std::max<size_t>(1, windows)
+              << " us of CPU per window" << std::endl;
+    std::cerr << "Sustains about " << static_cast<size_t>(std::floor(capacity / per_stream)) << " real-time streams with a "
+              << hop << "-sample hop on " << cores << " core(s)";
+    if (speed > 0)
+        std::cerr << "; this run " << (worst_lag_ns * speed <= 1e9 * hop / WAV_MODEL_RATE ? "kept up" : "fell behind")
+                  << " at " << speed << "x real time (worst lag " << worst_lag_ns / 1e6 << " ms)";
+    std::cerr << std::endl;
+    std::cerr.unsetf(std::ios::fixed);
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "dataset.h"
+#include "synth.h"
+#include "wav.h"
+#include "engine/parallel.h"
+
+static const size_t SYNTH_WINDOWS = 1000;
+static const size_t SYNTH_SAMPLES = 16000; // One second, the model input
+static const uint64_t SYNTH_SEED = 42;
+static const size_t SYNTH_BLOCK = 256;     // Windows each thread generates per round
+
+static std::ofstream open_output(const std::string &path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("cannot write \"" + path + "\": " + std::strerror(errno));
+    return out;
+}
+
+static void make_directory(const std::string &path) {
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+        throw std::runtime_error("cannot create directory \"" + path + "\": " + std::strerror(errno));
+}
+
+// One CSV row of x_test.csv: the samples in the units convert_input() scales back by 2^FIXED_POINT, exactly
+static void write_csv_row(std::ostream &out, const number_t *samples, size_t count) {
+    char value[32];
+    for (size_t i = 0; i < count; i++) {
+        const int length = std::snprintf(value, sizeof(value), i == 0 ? "%.11g" : ",%.11g", samples[i] / double(1 << FIXED_POINT));
+        out.write(value, length);
+    }
+    out.put('\n');
+}
+
+static void write_checked(std::ofstream &out, const std::string &path) {
+    out.flush();
+    if (!out)
+        throw std::runtime_error("error writing \"" + path + "\"");
+}
+
+int main(int argc, const char *argv[]) {
+    // "--windows n" windows of "--samples n" samples are generated from "--seed s" on "--threads n" threads; the output
+    // is the same whatever the number of threads
+    size_t windows = SYNTH_WINDOWS, samples = SYNTH_SAMPLES, threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t seed = SYNTH_SEED;
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+        if (std::strcmp(argv[arg], "--windows") == 0)
+            windows = std::strtoull(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--samples") == 0)
+            samples = std::max<size_t>(1, std::strtoul(argv[arg + 1], NULL, 10));
+        else if (std::strcmp(argv[arg], "--seed") == 0)
+            seed = std::strtoull(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--threads") == 0)
+            threads = std::max<size_t>(1, std::strtoul(argv[arg + 1], NULL, 10));
+        else
+            break;
+    }
+    const std::string format = arg < argc ? argv[arg] : "";
+    const int outputs = argc - arg - 1;
+    if (!((format == "csv" && outputs == 2) || ((format == "wav" || format == "recording" || format == "binary") && outputs == 1))) {
+        const std::string usage = std::string("Usage: ") + argv[0] + " [--windows n] [--samples n] [--seed s] [--threads n] ";
+        std::cerr << usage << "csv x.csv y.csv" << std::endl;
+        std::cerr << std::string(usage.size(), ' ') << "wav recordings/" << std::endl;
+        std::cerr << std::string(usage.size(), ' ') << "recording recording.wav > labels.csv" << std::endl;
+        std::cerr << std::string(usage.size(), ' ') << "binary dataset.gscd" << std::endl;
+        exit(1);
+    }
+
+    try {
+        // "csv": x/y rows like x_test.csv and y_test.csv; "wav": recordings/<class>/splitted_<index>.wav for run_graph's
+        // directory mode; "recording": the windows back to back in one WAV file for gsc_scan and gsc_streams, with the
+        // start and class of each window on stdout; "binary": a dataset file run_graph maps
+        const std::string path = argv[arg + 1];
+        std::ofstream out, labels_out;
+        if (format == "csv") {
+            out = open_output(path);
+            labels_out = open_output(argv[arg + 2]);
+        } else if (format == "wav") {
+            make_directory(path);
+            for (const char *name : SYNTH_CLASS_NAMES)
+                make_directory(path + "/" + name);
+        } else if (format == "recording") {
+            out = open_output(path);
+            write_wav_header(out, WAV_MODEL_RATE, 1, static_cast<uint64_t>(windows) * samples);
+            std::cout << "start_s,label" << std::endl;
+        } else {
+            out = open_output(path);
+            write_binary_dataset_header(out, SYNTH_CLASSES, samples, windows);
+        }
+        std::vector<uint16_t> labels; // Binary datasets end with them
+
+        // Each round generates a block of windows per thread, then writes them in order
+        const auto start = std::chrono::steady_clock::now();
+        WorkerPool pool(threads);
+        std::vector<std::vector<double>> scratch(threads, std::vector<double>(samples));
+        std::vector<number_t> block(threads * SYNTH_BLOCK * samples);
+        std::vector<size_t> block_labels(threads * SYNTH_BLOCK);
+        for (size_t first = 0; first < windows; first += threads * SYNTH_BLOCK) {
+            const size_t count = std::min(threads * SYNTH_BLOCK, windows - first);
+            auto generate = [&](size_t slice) {
+                for (size_t w = slice * SYNTH_BLOCK; w < std::min(count, (slice + 1) * SYNTH_BLOCK); w++)
+                    block_labels[w] = synth_window(seed, first + w, samples, scratch[slice].data(), &block[w * samples]);
+            };
+            pool.run(generate);
+
+            for (size_t w = 0; w < count; w++) {
+                const number_t *window = &block[w * samples];
+                const size_t label = block_labels[w];
+                if (format == "csv") {
+                    write_csv_row(out, window, samples);
+                    for (size_t c = 0; c < SYNTH_CLASSES; c++)
+                        labels_out << (c == 0 ? "" : ",") << (c == label ? 1 : 0);
+                    labels_out << "\n";
+                } else if (format == "wav") {
+                    char name[32];
+                    std::snprintf(name, sizeof(name), "/splitted_%08zu.wav", first + w);
+                    const std::string file = path + "/" + SYNTH_CLASS_NAMES[label] + name;
+                    std::ofstream wav = open_output(file);
+                    write_wav_header(wav, WAV_MODEL_RATE, 1, samples);
+                    wav.write(reinterpret_cast<const char *>(window), samples * sizeof(number_t));
+                    write_checked(wav, file);
+                } else {
+                    out.write(reinterpret_cast<const char *>(window), samples * sizeof(number_t));
+                    if (format == "recording")
+                        std::cout << double((first + w) * samples) / WAV_MODEL_RATE << "," << label << "\n";
+                    else
+                        labels.push_back(static_cast<uint16_t>(label));
+                }
+            }
+        }
+        if (format == "binary")
+            out.write(reinterpret_cast<const char *>(labels.data()), labels.size() * sizeof(uint16_t));
+        if (out.is_open())
+            write_checked(out, path);
+        if (labels_out.is_open())
+            write_checked(labels_out, argv[arg + 2]);
+        std::cout.flush();
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "Generated " << windows << " windows of " << samples << " samples (" << double(windows) * samples / WAV_MODEL_RATE
+                  << " s of audio) in " << seconds << " s on " << threads << " thread(s): " << windows / seconds
+                  << " windows/s" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+    return 0;
+}
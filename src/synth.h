@@ -0,0 +1,126 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "number.h"
+
+// Deterministic synthetic audio for benchmarks without downloaded recordings. Every window is generated from the seed
+// and its own index alone, with an integer PRNG and no std:: distribution (whose output differs between standard
+// libraries), so a dataset is the same on every machine, whatever the number of threads that generated it.
+// Samples are raw 16 kHz int16 values like the recordings, the input of a model exported with normalization.csv.
+static const size_t SYNTH_CLASSES = 3;
+static const char *const SYNTH_CLASS_NAMES[SYNTH_CLASSES] = {"0_chirp", "1_harmonic", "2_background"};
+static const double SYNTH_RATE = 16000;
+
+// xorshift64* seeded through splitmix64
+class SynthRng {
+public:
+    explicit SynthRng(uint64_t seed) {
+        seed += 0x9e3779b97f4a7c15ull;
+        seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+        seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+        state_ = (seed ^ (seed >> 31)) | 1;
+    }
+
+    uint64_t next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545f4914f6cdd1dull;
+    }
+
+    // In [0, 1)
+    double uniform() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    double uniform(double low, double high) {
+        return low + (high - low) * uniform();
+    }
+
+    // In [0, count)
+    size_t below(size_t count) {
+        return static_cast<size_t>(uniform() * count);
+    }
+
+    // Sum of uniforms, close enough to a unit normal for noise and cheaper than Box-Muller
+    double noise() {
+        double sum = 0;
+        for (int i = 0; i < 4; i++)
+            sum += uniform();
+        return (sum - 2.0) * 1.7320508075688772; // Variance of the sum is 4 / 12
+    }
+
+private:
+    uint64_t state_;
+};
+
+// Adds a call with a Hann envelope from sample `start` on, `length` samples long, at `amplitude`; frequency(t) gives
+// the instantaneous frequency in Hz at t in [0, 1) of the call, harmonics the relative amplitude of each overtone
+template<typename F>
+static void synth_call(double *signal, size_t samples, size_t start, size_t length, double amplitude, F frequency,
+                       const double *harmonics, size_t harmonic_count) {
+    const double pi = 3.14159265358979323846;
+    double phase = 0;
+    for (size_t i = 0; i < length && start + i < samples; i++) {
+        const double t = double(i) / length;
+        const double envelope = 0.5 - 0.5 * std::cos(2 * pi * t);
+        const double f = frequency(t);
+        phase += 2 * pi * f / SYNTH_RATE;
+        double value = std::sin(phase);
+        // Overtones above the Nyquist frequency would alias, they are left out
+        for (size_t h = 0; h < harmonic_count && f * (h + 2) < SYNTH_RATE / 2; h++)
+            value += harmonics[h] * std::sin((h + 2) * phase);
+        signal[start + i] += amplitude * envelope * value;
+    }
+}
+
+// Window `index` of the dataset `seed`: a noise bed under up to a few calls. Class 0 holds frequency sweeps (chirps),
+// class 1 harmonic notes with vibrato, class 2 the noise bed alone or near silence. `scratch` holds `samples` values.
+static inline size_t synth_window(uint64_t seed, uint64_t index, size_t samples, double *scratch, number_t *out) {
+    SynthRng rng(seed * 0x100000001b3ull ^ index);
+    const size_t label = rng.below(SYNTH_CLASSES);
+
+    // Noise bed: white noise through a one-pole low-pass, from near silence to a windy recording
+    const bool silent = label == 2 && rng.uniform() < 0.3;
+    const double level = silent ? rng.uniform(0, 20) : rng.uniform(50, 800);
+    const double smoothing = rng.uniform(0.0, 0.95);
+    double lowpassed = 0;
+    for (size_t i = 0; i < samples; i++) {
+        lowpassed = smoothing * lowpassed + (1 - smoothing) * rng.noise();
+        scratch[i] = level * lowpassed / std::sqrt((1 - smoothing) / (1 + smoothing));
+    }
+
+    if (label == 0) {
+        const size_t calls = 1 + rng.below(4);
+        for (size_t c = 0; c < calls; c++) {
+            const size_t length = static_cast<size_t>(rng.uniform(0.05, 0.3) * SYNTH_RATE);
+            const size_t start = rng.below(samples > length ? samples - length : 1);
+            const double from = rng.uniform(2000, 6000), to = from + rng.uniform(-1500, 1500);
+            synth_call(scratch, samples, start, length, rng.uniform(2000, 12000),
+                       [&](double t) { return from + (to - from) * t; }, nullptr, 0);
+        }
+    } else if (label == 1) {
+        const size_t notes = 1 + rng.below(3);
+        for (size_t n = 0; n < notes; n++) {
+            const size_t length = static_cast<size_t>(rng.uniform(0.1, 0.5) * SYNTH_RATE);
+            const size_t start = rng.below(samples > length ? samples - length : 1);
+            const double fundamental = rng.uniform(1000, 3500), rate = rng.uniform(5, 15), depth = rng.uniform(0.02, 0.05);
+            const double harmonics[3] = {rng.uniform(0.2, 0.6), rng.uniform(0.1, 0.3), rng.uniform(0.0, 0.15)};
+            const double pi = 3.14159265358979323846;
+            synth_call(scratch, samples, start, length, rng.uniform(2000, 8000),
+                       [&](double t) { return fundamental * (1 + depth * std::sin(2 * pi * rate * t * length / SYNTH_RATE)); },
+                       harmonics, 3);
+        }
+    }
+
+    for (size_t i = 0; i < samples; i++) {
+        const double value = std::floor(scratch[i] + 0.5);
+        out[i] = clamp_to_number_t(static_cast<long_number_t>(value < -32768 ? -32768 : value > 32767 ? 32767 : value));
+    }
+    return label;
+}
+
+#endif // SYNTH_H
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dataset.h"
+#include "model.h"
+#include "ring.h"
+#include "serving.h"
+#include "engine/timing.h"
+
+static const size_t TRANSPORT_WINDOWS = 2000;
+static const size_t TRANSPORT_DISTINCT = 16; // Distinct random windows sent in turn
+
+struct TransportResult {
+    double windows_per_s = 0;
+    double p50_ns = 0, p99_ns = 0;
+    std::vector<uint32_t> labels; // Label of each window sent
+};
+
+// Sends `count` windows from `producers` threads, each one window at a time like one capture process; send(window,
+// samples) returns the label of one window
+static TransportResult run_producers(size_t producers, size_t count, const std::vector<number_t> &windows, size_t samples,
+                                     const std::function<std::function<uint32_t(const number_t *)>()> &connect) {
+    TransportResult result;
+    result.labels.resize(count);
+    std::vector<double> latencies(count);
+    std::vector<std::thread> threads;
+    std::vector<std::string> errors(producers);
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            try {
+                auto send = connect();
+                for (size_t i = p; i < count; i += producers) {
+                    const auto sent = std::chrono::steady_clock::now();
+                    result.labels[i] = send(&windows[i % TRANSPORT_DISTINCT * samples]);
+                    latencies[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - sent).count();
+                }
+            } catch (const std::exception &e) {
+                errors[p] = e.what();
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const std::string &error : errors) {
+        if (!error.empty())
+            throw std::runtime_error(error);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.windows_per_s = count / seconds;
+    result.p50_ns = percentile(latencies, 0.5);
+    result.p99_ns = percentile(latencies, 0.99);
+    return result;
+}
+
+int main(int argc, const char *argv[]) {
+    // Both transports of one gsc_daemon started with --ring, fed the same windows by the same number of producers
+    size_t producers = 1, count = TRANSPORT_WINDOWS, samples = MODEL_INPUT_CHANNELS * MODEL_INPUT_SAMPLES;
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+        if (std::strcmp(argv[arg], "--producers") == 0)
+            producers = std::max<size_t>(1, std::strtoul(argv[arg + 1], NULL, 10));
+        else if (std::strcmp(argv[arg], "--windows") == 0)
+            count = std::strtoul(argv[arg + 1], NULL, 10);
+        else if (std::strcmp(argv[arg], "--samples") == 0)
+            samples = std::strtoul(argv[arg + 1], NULL, 10);
+        else
+            break;
+    }
+    if (argc - arg != 2 || samples == 0 || count == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--producers n] [--windows n] [--samples n] socket ring" << std::endl;
+        exit(1);
+    }
+    const char *socket_path = argv[arg], *ring_name = argv[arg + 1];
+    const std::vector<number_t> windows = random_inputs(TRANSPORT_DISTINCT, samples);
+
+    TransportResult socket, ring;
+    try {
+        socket = run_producers(producers, count, windows, samples, [&] {
+            std::shared_ptr<int> fd(new int(connect_unix(socket_path)), [](int *fd) {
+                close(*fd);
+                delete fd;
+            });
+            auto logits = std::make_shared<std::vector<number_t>>();
+            return [=](const number_t *window) {
+                RequestHeader request = {REQUEST_MAGIC, 0, static_cast<uint32_t>(samples)};
+                ResponseHeader response;
+                if (!write_full(*fd, &request, sizeof(request)) || !write_full(*fd, window, samples * sizeof(number_t)) ||
+                    !read_full(*fd, &response, sizeof(response)) || response.magic != RESPONSE_MAGIC)
+                    throw std::runtime_error("the daemon closed the connection or sent a bad response");
+                logits->resize(response.logits);
+                if (!read_full(*fd, logits->data(), logits->size() * sizeof(number_t)))
+                    throw std::runtime_error("the daemon closed the connection");
+                return response.label;
+            };
+        });
+        ring = run_producers(producers, count, windows, samples, [&] {
+            // Each producer maps the segment on its own, as a separate capture process would
+            auto mapping = std::make_shared<WindowRing>(WindowRing::open(ring_name));
+            if (mapping->samples() != samples)
+                throw std::runtime_error("the ring holds windows of " + std::to_string(mapping->samples()) + " samples");
+            auto logits = std::make_shared<std::vector<number_t>>(mapping->outputs());
+            return [=](const number_t *window) {
+                const uint64_t pos = mapping->claim();
+                // A capture process would write its samples there directly
+                std::memcpy(mapping->window(pos), window, samples * sizeof(number_t));
+                mapping->publish(pos);
+                return mapping->wait_result(pos, logits->data());
+            };
+        });
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(1);
+    }
+
+    std::cout << "transport,producers,windows,windows_per_s,p50_us,p99_us" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    const std::pair<const char *, const TransportResult *> rows[] = {{"socket", &socket}, {"ring", &ring}};
+    for (const auto &row : rows) {
+        std::cout << row.first << "," << producers << "," << count << "," << row.second->windows_per_s << ","
+                  << row.second->p50_ns / 1000 << "," << row.second->p99_ns / 1000 << std::endl;
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cerr << "Ring throughput " << ring.windows_per_s / socket.windows_per_s << "x the socket's" << std::endl;
+    if (socket.labels != ring.labels) {
+        std::cerr << "Error: the transports returned different labels" << std::endl;
+        exit(1);
+    }
+    return 0;
+}
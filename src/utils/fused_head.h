@@ -0,0 +1,88 @@
+/**
+ * Fused classification head for the generated model: max_pooling1d_3, average_pooling1d, flatten and dense run as one
+ * pass over the conv1d_2 output, and the predicted class comes out directly instead of through a separate scan of the
+ * logits. Include it after the generated model (gsc_model.h, or model.c which holds the static layer functions).
+ */
+#ifndef FUSED_HEAD_H
+#define FUSED_HEAD_H
+
+// Head shape of build_model() in training.py, checked against the generated types below. All three layers are linear.
+#define HEAD_CHANNELS       32 // conv1d_2 filters
+#define HEAD_IN_SAMPLES     45 // conv1d_2 output samples
+#define HEAD_POOL_SIZE      4  // max_pooling1d_3, stride equal to the pool
+#define HEAD_POOLED_SAMPLES ( (HEAD_IN_SAMPLES - HEAD_POOL_SIZE) / HEAD_POOL_SIZE + 1 )
+#define HEAD_AVG_SIZE       8  // average_pooling1d, stride equal to the pool
+#define HEAD_AVG_SAMPLES    ( (HEAD_POOLED_SAMPLES - HEAD_AVG_SIZE) / HEAD_AVG_SIZE + 1 )
+#define HEAD_UNITS          MODEL_OUTPUT_SAMPLES
+
+static_assert(sizeof(conv1d_2_output_type) == sizeof(number_t[HEAD_CHANNELS][HEAD_IN_SAMPLES]), "conv1d_2 shape changed");
+static_assert(sizeof(max_pooling1d_3_output_type) == sizeof(number_t[HEAD_CHANNELS][HEAD_POOLED_SAMPLES]), "max_pooling1d_3 shape changed");
+static_assert(sizeof(average_pooling1d_output_type) == sizeof(number_t[HEAD_CHANNELS][HEAD_AVG_SAMPLES]), "average_pooling1d shape changed");
+static_assert(sizeof(dense_kernel) == sizeof(number_t[HEAD_UNITS][HEAD_CHANNELS * HEAD_AVG_SAMPLES]), "dense shape changed");
+
+// Computes the dense outputs from the conv1d_2 output, bit-exact with the four generated layers: only the pooled maxima
+// the average pool reads are computed, each average goes straight into the dense accumulators. Returns the index of
+// the largest output (the first one on ties) and stores that output in max_logit.
+static inline unsigned int fused_head(
+  const number_t input[HEAD_CHANNELS][HEAD_IN_SAMPLES],
+  number_t *max_logit) {
+
+  long_number_t acc[HEAD_UNITS] = {0};
+  for (unsigned short k = 0; k < HEAD_CHANNELS; k++) {
+    for (unsigned short pos_x = 0; pos_x < HEAD_AVG_SAMPLES; pos_x++) {
+      long_number_t tmp = 0;
+      for (unsigned short a = 0; a < HEAD_AVG_SIZE; a++) {
+        const number_t *window = &input[k][(pos_x * HEAD_AVG_SIZE + a) * HEAD_POOL_SIZE];
+        number_t pooled = window[0];
+        for (unsigned short x = 1; x < HEAD_POOL_SIZE; x++)
+          if (window[x] > pooled)
+            pooled = window[x];
+        tmp += pooled;
+      }
+      const number_t avg = clamp_to_number_t(tmp / HEAD_AVG_SIZE);
+
+      // flatten is a no-op: this average is dense input k * HEAD_AVG_SAMPLES + pos_x
+      for (unsigned short u = 0; u < HEAD_UNITS; u++)
+        acc[u] += dense_kernel[u][k * HEAD_AVG_SAMPLES + pos_x] * avg;
+    }
+  }
+
+  unsigned int label = 0;
+  for (unsigned short u = 0; u < HEAD_UNITS; u++) {
+    const number_t logit = clamp_to_number_t(scale_number_t(acc[u]) + dense_bias[u]);
+    if (u == 0 || logit > *max_logit) {
+      *max_logit = logit;
+      label = u;
+    }
+  }
+  return label;
+}
+
+// cnn() with the fused head: returns the predicted class and stores its output in max_logit
+static inline unsigned int cnn_classify(
+  const number_t input[MODEL_INPUT_CHANNELS][MODEL_INPUT_SAMPLES],
+  number_t *max_logit) {
+
+  // Same buffer sharing as cnn(), without the head tensors
+  static union {
+    max_pooling1d_output_type max_pooling1d_output;
+    max_pooling1d_1_output_type max_pooling1d_1_output;
+    max_pooling1d_2_output_type max_pooling1d_2_output;
+  } activations1;
+
+  static union {
+    conv1d_output_type conv1d_output;
+    conv1d_1_output_type conv1d_1_output;
+    conv1d_2_output_type conv1d_2_output;
+  } activations2;
+
+  max_pooling1d(input, activations1.max_pooling1d_output);
+  conv1d(activations1.max_pooling1d_output, conv1d_kernel, conv1d_bias, activations2.conv1d_output);
+  max_pooling1d_1(activations2.conv1d_output, activations1.max_pooling1d_1_output);
+  conv1d_1(activations1.max_pooling1d_1_output, conv1d_1_kernel, conv1d_1_bias, activations2.conv1d_1_output);
+  max_pooling1d_2(activations2.conv1d_1_output, activations1.max_pooling1d_2_output);
+  conv1d_2(activations1.max_pooling1d_2_output, conv1d_2_kernel, conv1d_2_bias, activations2.conv1d_2_output);
+  return fused_head(activations2.conv1d_2_output, max_logit);
+}
+
+#endif // FUSED_HEAD_H
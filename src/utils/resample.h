@@ -0,0 +1,168 @@
+/**
+ * Streaming fixed-point polyphase resampler from any integer sample rate to another, shared by the host tools (WAV files
+ * at 44.1 or 48 kHz) and the firmware (I2S running faster than the model rate). Portable C with int16 samples and Q15
+ * coefficients; on SSE2 hosts the dot products use _mm_madd_epi16, bit-exact with the portable loop since both
+ * accumulate the same products in 32 bits.
+ *
+ * The rate ratio up/down is reduced by their gcd. The prototype is a Kaiser windowed sinc at the lower Nyquist
+ * frequency of the two rates, split into `up` phases of `taps` coefficients: each output is one phase's dot product
+ * with the last `taps` inputs, so only the coefficients that meet a non-zero input are ever multiplied.
+ */
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define RESAMPLE_ORDER       32  // Taps per period of the lower rate: longer is a sharper transition at the Nyquist frequency
+#define RESAMPLE_KAISER_BETA 8.0 // About 80 dB of stopband attenuation before quantization
+
+// Taps of each phase when decimating by an integer factor, to size static buffers (multiple of 8 for the SIMD loop)
+#define RESAMPLE_DECIMATION_TAPS(factor) ( (RESAMPLE_ORDER * (factor) + 7) / 8 * 8 )
+
+typedef struct {
+  unsigned int up, down;   // Reduced rate ratio: out_rate / in_rate = up / down
+  unsigned int taps;       // Coefficients of each phase
+  unsigned int phase;      // Phase of the next output, outputs are due while it is below `up`
+  unsigned int pos;        // Oldest input of the history
+  const int16_t *coeffs;   // [up][taps], reversed so that they line up with the history from oldest to newest
+  int16_t *history;        // [2 * taps]: every input is stored twice, so the last `taps` are always contiguous
+} resampler_t;
+
+static inline unsigned int resample_gcd(unsigned int a, unsigned int b) {
+  while (b) {
+    unsigned int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+static inline unsigned int resample_taps(unsigned int in_rate, unsigned int out_rate) {
+  const unsigned int g = resample_gcd(in_rate, out_rate);
+  const unsigned int up = out_rate / g, down = in_rate / g;
+  // Decimating spreads each output's low-pass over down / up inputs per period of the output rate
+  const unsigned int periods = down > up ? (down + up - 1) / up : 1;
+  return (RESAMPLE_ORDER * periods + 7) / 8 * 8;
+}
+
+// Size of the coefficient buffer resample_design() fills
+static inline size_t resample_coeff_count(unsigned int in_rate, unsigned int out_rate) {
+  return (size_t)(out_rate / resample_gcd(in_rate, out_rate)) * resample_taps(in_rate, out_rate);
+}
+
+// Center of the prototype at the upsampled rate: the multiple of `down` nearest to the middle, so that the filter
+// delays the signal by a whole number of outputs
+static inline size_t resample_center(unsigned int up, unsigned int down, unsigned int taps) {
+  const size_t length = (size_t)up * taps;
+  return (length - 1 + down) / (2 * down) * down;
+}
+
+// Modified Bessel function of the first kind, order 0, for the Kaiser window
+static inline double resample_bessel_i0(double x) {
+  double sum = 1.0, term = 1.0;
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+// Computes the Q15 coefficients of the in_rate -> out_rate filter once, at setup (uses double precision math)
+static inline void resample_design(unsigned int in_rate, unsigned int out_rate, int16_t *coeffs) {
+  const unsigned int g = resample_gcd(in_rate, out_rate);
+  const unsigned int up = out_rate / g, down = in_rate / g, taps = resample_taps(in_rate, out_rate);
+  const size_t length = (size_t)up * taps;
+  const double cutoff = 0.5 / (up > down ? up : down); // Cycles per sample at the upsampled rate
+  const double center = (double)resample_center(up, down, taps), pi = 3.14159265358979323846;
+  const double half = (center > length - 1 - center ? center : length - 1 - center) + 0.5; // Window half-width
+  for (size_t j = 0; j < length; j++) {
+    const double t = j - center, r = t / half;
+    const double sinc = t == 0 ? 2.0 * cutoff : sin(2.0 * pi * cutoff * t) / (pi * t);
+    const double window = resample_bessel_i0(RESAMPLE_KAISER_BETA * sqrt(1.0 - r * r)) / resample_bessel_i0(RESAMPLE_KAISER_BETA);
+    // Each phase sums to about one, the gain of `up` making up for the zeros upsampling inserts
+    double value = floor(sinc * window * up * 32768.0 + 0.5);
+    value = value > 32767.0 ? 32767.0 : value < -32767.0 ? -32767.0 : value;
+    // Coefficient j = k * up + phase multiplies the input k samples before the newest one
+    const size_t phase = j % up, k = j / up;
+    coeffs[phase * taps + (taps - 1 - k)] = (int16_t)value;
+  }
+}
+
+// `coeffs` from resample_design() and `history` (2 * resample_taps() values) must outlive the resampler
+static inline void resample_init(resampler_t *r, unsigned int in_rate, unsigned int out_rate, const int16_t *coeffs,
+                                 int16_t *history) {
+  const unsigned int g = resample_gcd(in_rate, out_rate);
+  r->up = out_rate / g;
+  r->down = in_rate / g;
+  r->taps = resample_taps(in_rate, out_rate);
+  r->phase = 0;
+  r->pos = 0;
+  r->coeffs = coeffs;
+  r->history = history;
+  for (unsigned int i = 0; i < 2 * r->taps; i++)
+    history[i] = 0;
+}
+
+// Most outputs resample_process() writes for `count` inputs
+static inline size_t resample_max_output(const resampler_t *r, size_t count) {
+  return (count * r->up + r->phase) / r->down + 1;
+}
+
+// Outputs by which the filter delays the signal, to drop from the start to keep timestamps aligned
+static inline size_t resample_delay(const resampler_t *r) {
+  return resample_center(r->up, r->down, r->taps) / r->down;
+}
+
+static inline int32_t resample_dot_portable(const int16_t *a, const int16_t *b, unsigned int taps) {
+  int32_t acc = 0;
+  for (unsigned int i = 0; i < taps; i++)
+    acc += (int32_t)a[i] * b[i];
+  return acc;
+}
+
+static inline int32_t resample_dot(const int16_t *a, const int16_t *b, unsigned int taps) {
+#if defined(__SSE2__)
+  __m128i acc = _mm_setzero_si128();
+  for (unsigned int i = 0; i < taps; i += 8)
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i))));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(acc);
+#else
+  return resample_dot_portable(a, b, taps);
+#endif
+}
+
+typedef int32_t (*resample_dot_fn)(const int16_t *a, const int16_t *b, unsigned int taps);
+
+// Feeds `count` inputs read every `stride` values (2 for the first channel of interleaved stereo), writes the outputs
+// that became due (at most resample_max_output()) and returns how many
+static inline size_t resample_process_with(resampler_t *r, const int16_t *input, size_t count, size_t stride,
+                                           int16_t *output, resample_dot_fn dot) {
+  size_t produced = 0;
+  for (size_t i = 0; i < count; i++) {
+    const int16_t x = input[i * stride];
+    r->history[r->pos] = x;
+    r->history[r->pos + r->taps] = x;
+    r->pos = r->pos + 1 == r->taps ? 0 : r->pos + 1;
+    for (; r->phase < r->up; r->phase += r->down) {
+      const int32_t acc = dot(r->coeffs + (size_t)r->phase * r->taps, r->history + r->pos, r->taps);
+      const int32_t y = (acc + (1 << 14)) >> 15;
+      output[produced++] = (int16_t)(y > 32767 ? 32767 : y < -32768 ? -32768 : y);
+    }
+    r->phase -= r->up;
+  }
+  return produced;
+}
+
+static inline size_t resample_process(resampler_t *r, const int16_t *input, size_t count, size_t stride, int16_t *output) {
+  return resample_process_with(r, input, count, stride, output, resample_dot);
+}
+
+#endif // RESAMPLE_H
@@ -110,7 +110,7 @@ def normalize_data(x_train, x_test):
     x_train /= x_std
     x_test /= x_std
 
-    return x_train, x_test
+    return x_train, x_test, x_mean, x_std
 
 
 def create_dataset(directory, bird_classes, test_file):
@@ -120,9 +120,34 @@ def create_dataset(directory, bird_classes, test_file):
     x_train, y_train, x_test, y_test = np.array(x_train), to_categorical(np.array(y_train)), np.array(
         x_test), to_categorical(np.array(y_test))
 
-    x_train, x_test = normalize_data(x_train, x_test)
+    x_train, x_test, x_mean, x_std = normalize_data(x_train, x_test)
+
+    return x_train, y_train, x_test, y_test, x_mean, x_std
 
-    return x_train, y_train, x_test, y_test
+
+def fold_normalization(model, x_mean, x_std, fixed_point):
+    """
+    Fold the input normalization into the first convolution, so that the model takes raw samples.
+
+    (x - x_mean) / x_std is affine with a positive scale, so it commutes with the max pooling layers in front of the
+    first convolution and becomes part of its weights and bias. The generated C code reads a raw int16 sample x as the
+    fixed-point number x / 2**fixed_point, hence the 2**fixed_point factor on the weights.
+
+    Args:
+        model (keras.Model): The trained model, modified in place.
+        x_mean (float): Mean of the training samples.
+        x_std (float): Standard deviation of the training samples.
+        fixed_point (int): Number of fractional bits of the generated code.
+    """
+    for layer in model.layers:
+        if isinstance(layer, MaxPool1D):
+            continue
+        if not isinstance(layer, Conv1D):
+            raise ValueError(f"cannot fold the input normalization through layer {layer.name}")
+        kernel, bias = layer.get_weights()
+        layer.set_weights([kernel * (2 ** fixed_point / x_std), bias - x_mean / x_std * kernel.sum(axis=(0, 1))])
+        return
+    raise ValueError("no convolution to fold the input normalization into")
 
 
 def build_model():
@@ -146,11 +171,14 @@ def build_model():
     return model
 
 
-def create_model(directory, bird_classes, test_file):
-    x_train, y_train, x_test, y_test = create_dataset(directory, bird_classes, test_file)
+def create_model(directory, bird_classes, test_file, fixed_point):
+    x_train, y_train, x_test, y_test, x_mean, x_std = create_dataset(directory, bird_classes, test_file)
 
-    np.savetxt('x_test.csv', x_test.reshape(x_test.shape[0], -1), delimiter=',', fmt='%s')
+    # The exported model takes raw samples (see fold_normalization), so are the test inputs, in fixed-point units
+    x_raw = (x_test * x_std + x_mean) / 2 ** fixed_point
+    np.savetxt('x_test.csv', x_raw.reshape(x_raw.shape[0], -1), delimiter=',', fmt='%s')
     np.savetxt('y_test.csv', y_test, delimiter=',', fmt='%s')
+    np.savetxt('normalization.csv', [[x_mean, x_std]], delimiter=',', fmt='%s')
 
     model = build_model()
     model.summary()
@@ -168,4 +196,6 @@ def create_model(directory, bird_classes, test_file):
 
     # Remove the Softmax layer
     model = tf.keras.Model(model.input, model.layers[-2].output, name=model.name)
+
+    fold_normalization(model, x_mean, x_std, fixed_point)
     return model
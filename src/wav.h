@@ -0,0 +1,340 @@
+#ifndef WAV_H
+#define WAV_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "number.h"
+#include "utils/resample.h"
+
+// Sample rate of the recordings the model was trained on, and of the firmware's I2S capture
+static const uint32_t WAV_MODEL_RATE = 16000;
+
+// 16-bit PCM WAV file mapped read-only: the samples are used in place, interleaved when there are several channels.
+// Only little-endian hosts are supported, like the rest of the tools.
+class WavFile {
+public:
+    explicit WavFile(const std::string &path) : path_(path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open \"" + path + "\": " + std::strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < 12) {
+            close(fd);
+            throw std::runtime_error("\"" + path + "\" is not a WAV file");
+        }
+        bytes_ = static_cast<size_t>(st.st_size);
+        void *base = mmap(NULL, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+            throw std::runtime_error("cannot map \"" + path + "\": " + std::strerror(errno));
+        base_ = static_cast<const uint8_t *>(base);
+        try {
+            parse();
+        } catch (...) {
+            munmap(const_cast<uint8_t *>(base_), bytes_);
+            throw;
+        }
+    }
+
+    WavFile(WavFile &&other) noexcept
+        : path_(std::move(other.path_)), base_(other.base_), bytes_(other.bytes_), sample_rate_(other.sample_rate_),
+          channels_(other.channels_), frames_(other.frames_), samples_(other.samples_) {
+        other.base_ = nullptr;
+    }
+    WavFile(const WavFile &) = delete;
+    WavFile &operator=(const WavFile &) = delete;
+
+    ~WavFile() {
+        if (base_)
+            munmap(const_cast<uint8_t *>(base_), bytes_);
+    }
+
+    const std::string &path() const {
+        return path_;
+    }
+
+    uint32_t sample_rate() const {
+        return sample_rate_;
+    }
+
+    size_t channels() const {
+        return channels_;
+    }
+
+    // Samples per channel
+    size_t frames() const {
+        return frames_;
+    }
+
+    // frames() * channels() interleaved samples
+    const int16_t *samples() const {
+        return samples_;
+    }
+
+private:
+    static uint16_t u16(const uint8_t *p) {
+        return static_cast<uint16_t>(p[0] | p[1] << 8);
+    }
+
+    static uint32_t u32(const uint8_t *p) {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+               static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    // Walks the RIFF chunks for "fmt " and "data", skipping the others (LIST, fact, ...)
+    void parse() {
+        if (std::memcmp(base_, "RIFF", 4) != 0 || std::memcmp(base_ + 8, "WAVE", 4) != 0)
+            throw std::runtime_error("\"" + path_ + "\" is not a WAV file");
+        bool format = false;
+        for (size_t offset = 12; offset + 8 <= bytes_;) {
+            const uint8_t *chunk = base_ + offset;
+            const size_t size = u32(chunk + 4), available = bytes_ - offset - 8;
+            if (std::memcmp(chunk, "fmt ", 4) == 0) {
+                if (size < 16 || size > available)
+                    break;
+                const uint16_t tag = u16(chunk + 8), bits = u16(chunk + 22);
+                // WAVE_FORMAT_EXTENSIBLE keeps the actual format in the first 2 bytes of its sub-format GUID
+                const bool pcm = tag == 1 || (tag == 0xfffe && size >= 40 && u16(chunk + 32) == 1);
+                channels_ = u16(chunk + 10);
+                sample_rate_ = u32(chunk + 12);
+                if (!pcm || bits != 16 || channels_ == 0)
+                    throw std::runtime_error("\"" + path_ + "\" is not 16-bit PCM");
+                format = true;
+            } else if (std::memcmp(chunk, "data", 4) == 0) {
+                if (!format)
+                    break;
+                // A truncated recording keeps the samples that made it to disk
+                frames_ = std::min(size, available) / (2 * channels_);
+                samples_ = reinterpret_cast<const int16_t *>(chunk + 8); // Chunks start at even offsets
+                return;
+            }
+            offset += 8 + size + (size & 1);
+        }
+        throw std::runtime_error("\"" + path_ + "\" has no 16-bit PCM format and data chunks");
+    }
+
+    std::string path_;
+    const uint8_t *base_ = nullptr;
+    size_t bytes_ = 0;
+    uint32_t sample_rate_ = 0;
+    size_t channels_ = 0;
+    size_t frames_ = 0;
+    const int16_t *samples_ = nullptr;
+};
+
+// Header of a 16-bit PCM WAV file whose `frames` samples per channel follow, interleaved
+inline void write_wav_header(std::ostream &out, uint32_t sample_rate, uint16_t channels, uint64_t frames) {
+    const uint64_t data = frames * channels * 2;
+    if (data > 0xffffffffull - 36)
+        throw std::runtime_error("a WAV file holds at most 4 GiB of samples");
+    auto u16 = [&](uint16_t value) { out.write(reinterpret_cast<const char *>(&value), sizeof(value)); };
+    auto u32 = [&](uint32_t value) { out.write(reinterpret_cast<const char *>(&value), sizeof(value)); };
+    out.write("RIFF", 4);
+    u32(static_cast<uint32_t>(36 + data));
+    out.write("WAVEfmt ", 8);
+    u32(16);
+    u16(1); // PCM
+    u16(channels);
+    u32(sample_rate);
+    u32(sample_rate * channels * 2);
+    u16(static_cast<uint16_t>(channels * 2));
+    u16(16);
+    out.write("data", 4);
+    u32(static_cast<uint32_t>(data));
+}
+
+// One channel of a WAV file at the model rate, read from start to end and resampled on the way when the file has another
+// rate. The resampler's delay is compensated, so that sample i of the output is at the time of input sample i * rate
+// / WAV_MODEL_RATE; the output has ceil(frames * WAV_MODEL_RATE / rate) samples.
+class ModelRateReader {
+public:
+    ModelRateReader(const WavFile &wav, size_t channel)
+        : wav_(wav), channel_(channel), resampling_(wav.sample_rate() != WAV_MODEL_RATE) {
+        if (wav.sample_rate() == 0)
+            throw std::runtime_error("\"" + wav.path() + "\" has a sample rate of 0");
+        frames_ = (static_cast<uint64_t>(wav.frames()) * WAV_MODEL_RATE + wav.sample_rate() - 1) / wav.sample_rate();
+        if (!resampling_)
+            return;
+        coeffs_.resize(resample_coeff_count(wav.sample_rate(), WAV_MODEL_RATE));
+        history_.resize(2 * resample_taps(wav.sample_rate(), WAV_MODEL_RATE));
+        resample_design(wav.sample_rate(), WAV_MODEL_RATE, coeffs_.data());
+        resample_init(&resampler_, wav.sample_rate(), WAV_MODEL_RATE, coeffs_.data(), history_.data());
+        skip_ = resample_delay(&resampler_);
+    }
+
+    ModelRateReader(const ModelRateReader &) = delete;
+    ModelRateReader &operator=(const ModelRateReader &) = delete;
+
+    // Samples the reader yields in total
+    size_t frames() const {
+        return frames_;
+    }
+
+    // Writes the next samples, fewer than `count` only at the end
+    size_t read(number_t *out, size_t count) {
+        count = std::min(count, frames_ - produced_);
+        size_t written = 0;
+        while (written < count) {
+            if (!resampling_) {
+                for (; written < count; written++, produced_++)
+                    out[written] = clamp_to_number_t(static_cast<long_number_t>(wav_.samples()[produced_ * wav_.channels() + channel_]));
+                break;
+            }
+            if (pending_.empty())
+                refill();
+            const size_t n = std::min(count - written, pending_.size() - taken_);
+            for (size_t i = 0; i < n; i++)
+                out[written + i] = clamp_to_number_t(static_cast<long_number_t>(pending_[taken_ + i]));
+            written += n;
+            produced_ += n;
+            taken_ += n;
+            if (taken_ == pending_.size()) {
+                pending_.clear();
+                taken_ = 0;
+            }
+        }
+        return written;
+    }
+
+private:
+    // Resamples the next block of inputs, zeros past the end of the file to flush the filter
+    void refill() {
+        static const size_t BLOCK = 4096;
+        const size_t available = std::min(BLOCK, wav_.frames() - std::min(consumed_, wav_.frames()));
+        pending_.resize(resample_max_output(&resampler_, BLOCK));
+        size_t count;
+        if (available > 0) {
+            count = resample_process(&resampler_, wav_.samples() + consumed_ * wav_.channels() + channel_, available,
+                                     wav_.channels(), pending_.data());
+        } else {
+            const std::vector<int16_t> zeros(BLOCK);
+            count = resample_process(&resampler_, zeros.data(), BLOCK, 1, pending_.data());
+        }
+        consumed_ += available;
+        pending_.resize(count);
+        const size_t skipped = std::min(skip_, count);
+        pending_.erase(pending_.begin(), pending_.begin() + skipped);
+        skip_ -= skipped;
+    }
+
+    const WavFile &wav_;
+    const size_t channel_;
+    const bool resampling_;
+    size_t frames_, produced_ = 0;
+    std::vector<int16_t> coeffs_, history_;
+    resampler_t resampler_;
+    size_t skip_ = 0, consumed_ = 0;
+    std::vector<int16_t> pending_; // Resampled, not read yet from taken_ on
+    size_t taken_ = 0;
+};
+
+// Test set read from recordings/<class>/*.wav like process_audio_files() in utils/training.py, for models taking raw
+// samples (exported with training's normalization.csv): inputs are the int16 samples as they are, labels one-hot rows
+// like y_test.csv
+struct WavDataset {
+    std::vector<std::string> classes;
+    std::vector<std::string> paths;
+    std::vector<number_t> inputs; // paths.size() windows of `samples` samples
+    std::vector<float> labels;    // paths.size() rows of classes.size() values
+};
+
+// Sorted names of the entries of `directory` that are directories (`directories`) or .wav files
+inline std::vector<std::string> list_directory(const std::string &directory, bool directories) {
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        throw std::runtime_error("cannot open directory \"" + directory + "\": " + std::strerror(errno));
+    std::vector<std::string> names;
+    while (const dirent *entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        struct stat st;
+        if (stat((directory + "/" + name).c_str(), &st) != 0)
+            continue;
+        if (directories ? S_ISDIR(st.st_mode)
+                        : S_ISREG(st.st_mode) && name.size() > 4 && name.compare(name.size() - 4, 4, ".wav") == 0)
+            names.push_back(name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Loads the recordings of every class subdirectory of `directory`, `classes` giving the label order (the sorted
+// subdirectory names when empty, which is the order of main.py's birds). Like training, only the splits audio.py
+// wrote next to the long recordings it kept (names holding "splitted_") are read, unless `all_files`; each is cut or
+// zero padded to `samples` samples of its first channel, resampled to the model rate if needed. `test_list` keeps
+// only the paths it holds, spelled directory/class/file.wav like testing_list.txt, when not empty. Files are mapped
+// and decoded on `threads` threads.
+inline WavDataset load_wav_dataset(const std::string &directory, std::vector<std::string> classes, size_t samples,
+                                   size_t threads, const std::set<std::string> &test_list = std::set<std::string>(),
+                                   bool all_files = false) {
+    if (classes.empty())
+        classes = list_directory(directory, true);
+    WavDataset dataset;
+    dataset.classes = classes;
+    std::vector<size_t> labels;
+    for (size_t c = 0; c < classes.size(); c++) {
+        for (const std::string &name : list_directory(directory + "/" + classes[c], false)) {
+            const std::string path = directory + "/" + classes[c] + "/" + name;
+            if (!all_files && name.find("splitted_") == std::string::npos)
+                continue;
+            if (!test_list.empty() && !test_list.count(path))
+                continue;
+            dataset.paths.push_back(path);
+            labels.push_back(c);
+        }
+    }
+
+    const size_t count = dataset.paths.size();
+    if (count == 0)
+        throw std::runtime_error(std::string(all_files ? "no recordings" : "no split recordings (splitted_*.wav)") +
+                                 " in the class subdirectories of \"" + directory + "\"" + (test_list.empty() ? "" : " in the test list"));
+    dataset.inputs.assign(count * samples, 0);
+    dataset.labels.assign(count * classes.size(), 0.0f);
+    for (size_t i = 0; i < count; i++)
+        dataset.labels[i * classes.size() + labels[i]] = 1.0f;
+
+    // Files are handed out one at a time, so a few long recordings do not leave the other threads idle
+    std::atomic<size_t> next{0};
+    std::vector<std::string> errors(std::max<size_t>(1, threads));
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < errors.size(); t++) {
+        workers.emplace_back([&, t] {
+            try {
+                for (size_t i; (i = next.fetch_add(1)) < count;) {
+                    const WavFile wav(dataset.paths[i]);
+                    ModelRateReader(wav, 0).read(&dataset.inputs[i * samples], samples);
+                }
+            } catch (const std::exception &e) {
+                errors[t] = e.what();
+                next = count;
+            }
+        });
+    }
+    for (std::thread &worker : workers)
+        worker.join();
+    for (const std::string &error : errors) {
+        if (!error.empty())
+            throw std::runtime_error(error);
+    }
+    return dataset;
+}
+
+#endif // WAV_H